@@ -20,3 +20,57 @@ string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," filedata ${filedata})
 file(APPEND ${OUTPUT_C} "const std::string ${filename}{${filedata}};\n\n")
 # Append extern definitions to h file
 file(APPEND ${OUTPUT_H} "extern const std::string ${filename};\n\n")
+
+# Shaders may declare optional features in a "// @features NAME ..." line
+file(STRINGS ${INPUT_FILE} features REGEX "^// *@features ")
+if (features)
+  string(REGEX REPLACE "^// *@features +" "" features "${features}")
+  separate_arguments(features)
+  list(LENGTH features feature_count)
+  math(EXPR variant_count "1 << ${feature_count}")
+  math(EXPR last_variant "${variant_count} - 1")
+  math(EXPR last_feature "${feature_count} - 1")
+
+  # Defines are inserted right after the #version line that has to come first
+  string(FIND "${filedata}" "0x0a," version_end)
+  if (version_end EQUAL -1)
+    message(FATAL_ERROR "Shader ${INPUT_FILE} with features has to start with a #version line")
+  endif ()
+  math(EXPR version_end "${version_end} + 5")
+  string(SUBSTRING "${filedata}" 0 ${version_end} version_data)
+  string(SUBSTRING "${filedata}" ${version_end} -1 body_data)
+
+  # Variant N defines every feature whose bit is set in N
+  string(TOUPPER ${filename} prefix)
+  file(APPEND ${OUTPUT_H} "// Feature bits selecting one of ${filename}_variants\n")
+  file(APPEND ${OUTPUT_H} "enum : unsigned int {\n")
+  foreach (bit RANGE ${last_feature})
+    list(GET features ${bit} feature)
+    file(APPEND ${OUTPUT_H} "  ${prefix}_${feature} = 1u << ${bit},\n")
+  endforeach ()
+  file(APPEND ${OUTPUT_H} "};\n\n")
+
+  file(APPEND ${OUTPUT_C} "const std::string ${filename}_variants[${variant_count}]{\n")
+  foreach (variant RANGE ${last_variant})
+    set(defines "")
+    foreach (bit RANGE ${last_feature})
+      math(EXPR enabled "(${variant} >> ${bit}) & 1")
+      if (enabled)
+        list(GET features ${bit} feature)
+        set(defines "${defines}#define ${feature}\n")
+      endif ()
+    endforeach ()
+
+    # Convert the defines to hex through a temporary file
+    set(define_data "")
+    if (defines)
+      file(WRITE ${OUTPUT_C}.defines "${defines}")
+      file(READ ${OUTPUT_C}.defines define_data HEX)
+      file(REMOVE ${OUTPUT_C}.defines)
+      string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," define_data ${define_data})
+    endif ()
+    file(APPEND ${OUTPUT_C} "  {${version_data}${define_data}${body_data}},\n")
+  endforeach ()
+  file(APPEND ${OUTPUT_C} "};\n\n")
+  file(APPEND ${OUTPUT_H} "extern const std::string ${filename}_variants[${variant_count}];\n\n")
+endif ()
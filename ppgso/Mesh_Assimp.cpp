@@ -1,15 +1,19 @@
 #include <glm/glm.hpp>
 #include <sstream>
+#include <cmath>
+#include <algorithm>
 
 #include "Mesh_Assimp.h"
 
-ppgso::Mesh_Assimp::Mesh_Assimp(const std::string &obj_file) {
+ppgso::Mesh_Assimp::Mesh_Assimp(const std::string &obj_file, int lodLevels, float lodRatio)
+        : lodLevels{lodLevels}, lodRatio{lodRatio} {
 #ifdef DEBBUG_MODE
     std::cout << "Using ASSIMP Loader!" << std::endl;
 #endif
 
+    // Imported data is owned by the importer and released at the end of the constructor
     Assimp::Importer importer;
-    scene = importer.ReadFile(obj_file, aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene *scene = importer.ReadFile(obj_file, aiProcess_Triangulate | aiProcess_FlipUVs);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::stringstream msg;
@@ -17,7 +21,111 @@ ppgso::Mesh_Assimp::Mesh_Assimp(const std::string &obj_file) {
         throw std::runtime_error(msg.str());
     }
 
-    processNode(scene->mRootNode, scene);
+    std::vector<aiMesh *> meshes;
+    processNode(scene->mRootNode, scene, meshes);
+
+    // Size the shared buffers and the merged indices up front, only triangles are drawn
+    size_t vertexCount = 0, maxVertices = 0, indexCount = 0;
+    bool hasTexcoords = false, hasNormals = false;
+    for (auto mesh : meshes) {
+        vertexCount += mesh->mNumVertices;
+        maxVertices = std::max(maxVertices, static_cast<size_t>(mesh->mNumVertices));
+        for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+            if (mesh->mFaces[i].mNumIndices == 3) indexCount += 3;
+        hasTexcoords |= mesh->HasTextureCoords(0);
+        hasNormals |= mesh->HasNormals();
+    }
+    // Levels of detail at the default ratio at most double the index count
+    indices.reserve(lodLevels > 1 ? indexCount * 2 : indexCount);
+
+    if (vertexCount > 0) {
+        // Generate a vertex array object
+        glGenVertexArrays(1, &vao);
+        state::bindVertexArray(vao);
+
+        // Reserve vertex positions on GPU, meshes are uploaded into their ranges
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(aiVector3D), nullptr, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+        if (hasTexcoords) {
+            glGenBuffers(1, &tbo);
+            glBindBuffer(GL_ARRAY_BUFFER, tbo);
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(aiVector2D), nullptr, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+        }
+
+        if (hasNormals) {
+            glGenBuffers(1, &nbo);
+            glBindBuffer(GL_ARRAY_BUFFER, nbo);
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(aiVector3D), nullptr, GL_STATIC_DRAW);
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+        }
+
+        // Upload meshes and collect their level of detail ranges
+        std::vector<std::pair<GLint, std::vector<std::pair<size_t, size_t>>>> ranges;
+        GLint baseVertex = 0;
+        size_t levels = 0;
+        for (auto mesh : meshes) {
+            // Mesh bounds are merged from the meshes to avoid walking the vertices again
+            static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "Bounds expect packed float positions");
+            shapeBounds.push_back(computeBounds(reinterpret_cast<const float *>(mesh->mVertices), mesh->mNumVertices));
+            bounds = shapeBounds.size() == 1 ? shapeBounds.back() : mergeBounds(bounds, shapeBounds.back());
+
+            auto meshLevels = processMesh(mesh, baseVertex);
+            levels = std::max(levels, meshLevels.size());
+            if (!meshLevels.empty()) ranges.emplace_back(baseVertex, std::move(meshLevels));
+            baseVertex += static_cast<GLint>(mesh->mNumVertices);
+        }
+
+        // Mesh relative indices of all meshes fitting into 16 bits halve the index buffer size
+        type = maxVertices <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        size_t indexSize = type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(unsigned int);
+
+        // Upload indices to GPU, converted while writing into the mapped buffer
+        if (!indices.empty()) {
+            glGenBuffers(1, &ibo);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * indexSize, nullptr, GL_STATIC_DRAW);
+            auto target = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * indexSize,
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+            // Convert in client memory and upload from there when the buffer can not be mapped
+            std::vector<unsigned char> fallback;
+            if (!target) {
+                fallback.resize(indices.size() * indexSize);
+                target = fallback.data();
+            }
+
+            if (type == GL_UNSIGNED_SHORT)
+                std::copy(indices.begin(), indices.end(), static_cast<GLushort *>(target));
+            else
+                std::copy(indices.begin(), indices.end(), static_cast<unsigned int *>(target));
+
+            if (fallback.empty())
+                glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+            else
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, fallback.size(), fallback.data());
+        }
+
+        // Build one draw batch per level of detail, meshes with fewer levels reuse their coarsest one
+        lods.resize(levels);
+        for (size_t level = 0; level < levels; ++level) {
+            for (auto &range : ranges) {
+                auto &meshLevel = range.second[std::min(level, range.second.size() - 1)];
+                lods[level].counts.push_back(static_cast<GLsizei>(meshLevel.second));
+                lods[level].offsets.push_back(reinterpret_cast<const void *>(meshLevel.first * indexSize));
+                lods[level].baseVertices.push_back(range.first);
+            }
+        }
+    }
+
+    // Merged indices are not needed after the upload
+    indices = std::vector<unsigned int>();
 
     for (unsigned int i = 0; i < scene->mNumMaterials; ++i) {
         aiMaterial* material = scene->mMaterials[i];
@@ -40,102 +148,142 @@ ppgso::Mesh_Assimp::Mesh_Assimp(const std::string &obj_file) {
 }
 
 ppgso::Mesh_Assimp::~Mesh_Assimp() {
-    for(auto& buffer : buffers) {
-        glDeleteBuffers(1, &buffer.ibo);
-        glDeleteBuffers(1, &buffer.nbo);
-        glDeleteBuffers(1, &buffer.tbo);
-        glDeleteBuffers(1, &buffer.vbo);
-        glDeleteVertexArrays(1, &buffer.vao);
-    }
+    glDeleteBuffers(1, &ibo);
+    glDeleteBuffers(1, &nbo);
+    glDeleteBuffers(1, &tbo);
+    glDeleteBuffers(1, &vbo);
+    state::releaseVertexArray(vao);
+    glDeleteVertexArrays(1, &vao);
 }
 
-void ppgso::Mesh_Assimp::processNode(aiNode *node, const aiScene *pScene) {
+void ppgso::Mesh_Assimp::processNode(aiNode *node, const aiScene *pScene, std::vector<aiMesh *> &meshes) {
     for (unsigned int i = 0; i < node->mNumMeshes; ++i) {
-        aiMesh *mesh = pScene->mMeshes[node->mMeshes[i]];
-        processMesh(mesh);
+        meshes.push_back(pScene->mMeshes[node->mMeshes[i]]);
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; ++i) {
-        processNode(node->mChildren[i], pScene);
+        processNode(node->mChildren[i], pScene, meshes);
     }
 }
 
-void ppgso::Mesh_Assimp::processMesh(aiMesh *mesh) {
-    gl_buffer buffer;
+std::vector<std::pair<size_t, size_t>> ppgso::Mesh_Assimp::processMesh(aiMesh *mesh, GLint baseVertex) {
+    std::vector<std::pair<size_t, size_t>> levels;
+    if (mesh->mNumVertices == 0) return levels;
 
     // Process vertices
-    if (mesh->HasPositions()) {
-        // Generate a vertex array object
-        glGenVertexArrays(1, &buffer.vao);
-        glBindVertexArray(buffer.vao);
-
-        // Extract vertex positions from aiMesh and upload to GPU
-        glGenBuffers(1, &buffer.vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
-        glBufferData(GL_ARRAY_BUFFER, mesh->mNumVertices * sizeof(aiVector3D), mesh->mVertices, GL_STATIC_DRAW);
-        // Enable and set up vertex attribute pointer for positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
-
-    // Process texture coordinates
-    if (mesh->HasTextureCoords(0)) {
-        std::vector<aiVector2D> textureCoords;
-        for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-            aiVector3D texCoord = mesh->mTextureCoords[0][i]; // Assuming single texture channel (index 0)
-            textureCoords.push_back(aiVector2D(texCoord.x, texCoord.y));
-        }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, baseVertex * sizeof(aiVector3D), mesh->mNumVertices * sizeof(aiVector3D),
+                    mesh->mVertices);
 
-        glGenBuffers(1, &buffer.tbo);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer.tbo);
-        glBufferData(GL_ARRAY_BUFFER, textureCoords.size() * sizeof(aiVector2D), textureCoords.data(), GL_STATIC_DRAW);
+    // Process texture coordinates, meshes without them are zero filled
+    if (tbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, tbo);
 
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
+        // Write the first two components of texture channel 0 directly into the buffer
+        auto textureCoords = static_cast<aiVector2D *>(glMapBufferRange(GL_ARRAY_BUFFER,
+                                                                        baseVertex * sizeof(aiVector2D),
+                                                                        mesh->mNumVertices * sizeof(aiVector2D),
+                                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
 
+        // Write into client memory and upload from there when the range can not be mapped
+        std::vector<aiVector2D> fallback;
+        if (!textureCoords) {
+            fallback.resize(mesh->mNumVertices);
+            textureCoords = fallback.data();
+        }
 
-    // Process normals
-    if (mesh->HasNormals()) {
-        std::vector<aiVector3D> normals;
         for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
-            aiVector3D normal = mesh->mNormals[i];
-            normals.push_back(normal);
+            textureCoords[i] = mesh->HasTextureCoords(0)
+                               ? aiVector2D(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y)
+                               : aiVector2D(0.0f, 0.0f);
         }
 
-        glGenBuffers(1, &buffer.nbo);
-        glBindBuffer(GL_ARRAY_BUFFER, buffer.nbo);
-        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(aiVector3D), normals.data(), GL_STATIC_DRAW);
+        if (fallback.empty())
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, baseVertex * sizeof(aiVector2D), mesh->mNumVertices * sizeof(aiVector2D),
+                            fallback.data());
+    }
+
 
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    // Process normals, meshes without them are zero filled
+    if (nbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, nbo);
+        if (mesh->HasNormals()) {
+            glBufferSubData(GL_ARRAY_BUFFER, baseVertex * sizeof(aiVector3D), mesh->mNumVertices * sizeof(aiVector3D),
+                            mesh->mNormals);
+        } else {
+            std::vector<aiVector3D> zero(mesh->mNumVertices);
+            glBufferSubData(GL_ARRAY_BUFFER, baseVertex * sizeof(aiVector3D), mesh->mNumVertices * sizeof(aiVector3D),
+                            zero.data());
+        }
     }
 
 
-    // Process indices
+    // Process indices, triangles are appended straight to the merged indices
     if (mesh->HasFaces()) {
-        std::vector<unsigned int> indices;
+        // Polygons are triangulated on import, point and line faces are skipped
+        size_t offset = indices.size();
         for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
-            aiFace face = mesh->mFaces[i];
-            for (unsigned int j = 0; j < face.mNumIndices; ++j) {
-                indices.push_back(face.mIndices[j]);
-            }
+            const aiFace &face = mesh->mFaces[i];
+            if (face.mNumIndices != 3) continue;
+            indices.push_back(face.mIndices[0]);
+            indices.push_back(face.mIndices[1]);
+            indices.push_back(face.mIndices[2]);
         }
+        if (indices.size() == offset) return levels;
+        levels.emplace_back(offset, indices.size() - offset);
+
+        // Each level of detail is simplified from the previous one in place in the merged indices
+        static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "Simplification expects packed float positions");
+        for (int level = 1; level < lodLevels; ++level) {
+            auto previous = levels.back();
+            auto target = static_cast<size_t>(previous.second / 3 * lodRatio) * 3;
+            auto lod = simplify(indices.data() + previous.first, previous.second,
+                                reinterpret_cast<const float *>(mesh->mVertices), mesh->mNumVertices, target);
 
-        // Upload indices to GPU
-        glGenBuffers(1, &buffer.ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-        buffer.size = static_cast<GLsizei>(indices.size());
+            // Stop when the mesh can not be reduced any further
+            if (lod.empty() || lod.size() >= previous.second) break;
+            levels.emplace_back(indices.size(), lod.size());
+            indices.insert(indices.end(), lod.begin(), lod.end());
+        }
     }
 
-    buffers.push_back(buffer);
+    return levels;
 }
 
-void ppgso::Mesh_Assimp::render() {
-    for (auto &buffer : buffers) {
-        // Draw object
-        glBindVertexArray(buffer.vao);
-        glDrawElements(GL_TRIANGLES, buffer.size, GL_UNSIGNED_INT, nullptr);
-    }
+void ppgso::Mesh_Assimp::render(int lod) {
+    if (lods.empty()) return;
+    auto &batch = lods[glm::clamp(lod, 0, static_cast<int>(lods.size()) - 1)];
+
+    // Draw all meshes with a single call
+    state::bindVertexArray(vao);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), type, batch.offsets.data(),
+                                  static_cast<GLsizei>(batch.counts.size()), batch.baseVertices.data());
+}
+
+int ppgso::Mesh_Assimp::selectLod(float distance, float lodDistance) const {
+    if (distance <= lodDistance) return 0;
+    auto lod = 1 + static_cast<int>(std::log2(distance / lodDistance));
+    return std::min(lod, getLodCount() - 1);
+}
+
+int ppgso::Mesh_Assimp::getLodCount() const {
+    return std::max(static_cast<int>(lods.size()), 1);
+}
+
+size_t ppgso::Mesh_Assimp::getTriangleCount(int lod) const {
+    if (lods.empty()) return 0;
+    size_t triangles = 0;
+    for (auto count : lods[glm::clamp(lod, 0, static_cast<int>(lods.size()) - 1)].counts)
+        triangles += count / 3;
+    return triangles;
+}
+
+const ppgso::Bounds &ppgso::Mesh_Assimp::getBounds() const {
+    return bounds;
+}
+
+const std::vector<ppgso::Bounds> &ppgso::Mesh_Assimp::getShapeBounds() const {
+    return shapeBounds;
 }
@@ -11,6 +11,9 @@
 
 #include "shader.h"
 #include "texture.h"
+#include "simplify.h"
+#include "bounds.h"
+#include "state.h"
 
 // Edit by: Samuel Zaprazny
 // Adding assimp library
@@ -21,14 +24,30 @@
 namespace ppgso {
 
     class Mesh_Assimp {
-        struct gl_buffer {
-        public:
-            GLuint vao, vbo, tbo, nbo, ibo = 0;
-            GLsizei size = 0;
+        // Arguments of a single glMultiDrawElementsBaseVertex call drawing every mesh
+        struct draw_batch {
+            std::vector<GLsizei> counts;
+            std::vector<const void *> offsets;
+            std::vector<GLint> baseVertices;
         };
 
-        std::vector<gl_buffer> buffers;
-        const aiScene * scene;
+        // All meshes share the vertex and index buffers, indices are relative to the first vertex of their mesh
+        GLuint vao = 0, vbo = 0, tbo = 0, nbo = 0, ibo = 0;
+        GLenum type = GL_UNSIGNED_INT;
+
+        // One batch per level of detail, level 0 is the full geometry
+        std::vector<draw_batch> lods;
+
+        // Bounds computed on load for the whole mesh and each of its meshes
+        Bounds bounds;
+        std::vector<Bounds> shapeBounds;
+
+        // Import state, triangles and levels of detail of all meshes are appended to the merged indices
+        std::vector<unsigned int> indices;
+
+        // Level of detail chain generated for each mesh
+        int lodLevels;
+        float lodRatio;
 
         // Loaded materials
         std::vector<glm::vec3> ambient;
@@ -45,20 +64,83 @@ namespace ppgso {
          * vec2 TexCoord - Texture coordinate, position 1
          * vec3 Normal - Normal vector, position 2
          *
+         * Additional levels of detail are generated by quadric edge collapse simplification
+         * and stored in the same index buffer as the full geometry.
+         *
          * @param obj - File path to the obj file to load.
+         * @param lodLevels - Number of levels of detail to generate including the full geometry.
+         * @param lodRatio - Fraction of triangles kept from one level of detail to the next.
          */
-        Mesh_Assimp(const std::string &obj);
+        Mesh_Assimp(const std::string &obj, int lodLevels = 1, float lodRatio = 0.5f);
 
         ~Mesh_Assimp();
 
-        void processNode(aiNode *node, const aiScene *pScene);
+        /*!
+         * Collect all meshes referenced by the node and its children.
+         *
+         * @param node - Node of the imported scene hierarchy.
+         * @param pScene - Imported scene owning the meshes, only valid during import.
+         * @param meshes - Meshes in the order they are merged into the shared buffers.
+         */
+        void processNode(aiNode *node, const aiScene *pScene, std::vector<aiMesh *> &meshes);
+
+        /*!
+         * Upload a single imported mesh into the shared GPU buffers.
+         * Positions and normals are uploaded straight from the imported arrays, texture coordinates
+         * are written into a mapped buffer range without intermediate copies.
+         *
+         * @param mesh - Imported mesh, only valid during import.
+         * @param baseVertex - First vertex of the mesh in the shared vertex buffers.
+         * @return - Offset and size of each level of detail in the merged indices.
+         */
+        std::vector<std::pair<size_t, size_t>> processMesh(aiMesh *mesh, GLint baseVertex);
+
+        /*!
+         * Render the geometry of all meshes with a single glMultiDrawElementsBaseVertex call.
+         * Index type (16 or 32 bit) is chosen on load based on the vertex count of the largest mesh.
+         *
+         * @param lod - Level of detail to render, clamped to the coarsest level available.
+         */
+        void render(int lod = 0);
+
+        /*!
+         * Select level of detail for an object at a distance from the camera.
+         * Level 0 is used up to lodDistance, each doubling of the distance past it selects the next coarser level.
+         *
+         * @param distance - Distance of the object from the camera, usually divided by the object scale.
+         * @param lodDistance - Distance up to which the full geometry is rendered.
+         * @return - Level of detail to pass to render.
+         */
+        int selectLod(float distance, float lodDistance) const;
+
+        /*!
+         * Get number of levels of detail generated for the mesh.
+         *
+         * @return - Number of levels including the full geometry.
+         */
+        int getLodCount() const;
+
+        /*!
+         * Get number of triangles rendered for a level of detail.
+         *
+         * @param lod - Level of detail, clamped to the coarsest level available.
+         * @return - Number of triangles over all shapes of the mesh.
+         */
+        size_t getTriangleCount(int lod = 0) const;
 
-        void processMesh(aiMesh *mesh);
+        /*!
+         * Get bounding box and bounding sphere of the whole mesh in model space.
+         *
+         * @return - Bounds of all imported meshes.
+         */
+        const Bounds &getBounds() const;
 
         /*!
-         * Render the geometry associated with the mesh using glDrawElements.
+         * Get bounding box and bounding sphere of each imported mesh in model space.
+         *
+         * @return - Bounds of the meshes in the order they were merged.
          */
-        void render();
+        const std::vector<Bounds> &getShapeBounds() const;
     };
 }
 
@@ -1,9 +1,11 @@
 #include <glm/glm.hpp>
 #include <sstream>
+#include <cmath>
+#include <algorithm>
 
 #include "Mesh_Tiny.h"
 
-ppgso::Mesh_Tiny::Mesh_Tiny(const std::string &obj_file) {
+ppgso::Mesh_Tiny::Mesh_Tiny(const std::string &obj_file, int lodLevels, float lodRatio) {
 #ifdef DEBBUG_MODE
     std::cout << "Using Tiny Obj Loader!" << std::endl;
 #endif
@@ -19,73 +21,158 @@ ppgso::Mesh_Tiny::Mesh_Tiny(const std::string &obj_file) {
     throw std::runtime_error(msg.str());
   }
 
-  // Initialize OpenGL Buffers
+  // Merge all shapes into shared vertex arrays, shapes without texture coordinates or normals are zero filled
+  size_t vertexCount = 0, maxShapeVertices = 0;
+  bool hasTexcoords = false, hasNormals = false;
   for(auto& shape : shapes) {
-    gl_buffer buffer;
-
-    if(!shape.mesh.positions.empty()) {
-      // Generate a vertex array object
-      glGenVertexArrays(1, &buffer.vao);
-      glBindVertexArray(buffer.vao);
-
-      // Generate and upload a buffer with vertex positions to GPU
-      glGenBuffers(1, &buffer.vbo);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer.vbo);
-      glBufferData(GL_ARRAY_BUFFER, shape.mesh.positions.size() * sizeof(float), shape.mesh.positions.data(),
-                   GL_STATIC_DRAW);
-
-      // Bind the buffer to "Position" attribute in program
-      glEnableVertexAttribArray(0);
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
+    vertexCount += shape.mesh.positions.size() / 3;
+    maxShapeVertices = std::max(maxShapeVertices, shape.mesh.positions.size() / 3);
+    hasTexcoords |= !shape.mesh.texcoords.empty();
+    hasNormals |= !shape.mesh.normals.empty();
+  }
 
-    if(!shape.mesh.texcoords.empty()) {
-      // Generate and upload a buffer with texture coordinates to GPU
-      glGenBuffers(1, &buffer.tbo);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer.tbo);
-      glBufferData(GL_ARRAY_BUFFER, shape.mesh.texcoords.size() * sizeof(float), shape.mesh.texcoords.data(),
-                   GL_STATIC_DRAW);
+  std::vector<float> positions, texcoords, normals;
+  positions.reserve(vertexCount * 3);
+  if (hasTexcoords) texcoords.reserve(vertexCount * 2);
+  if (hasNormals) normals.reserve(vertexCount * 3);
 
-      glEnableVertexAttribArray(1);
-      glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    }
+  // Level of detail index ranges of each shape, in indices relative to the shape base vertex
+  struct shape_range {
+    GLint baseVertex;
+    std::vector<std::pair<size_t, size_t>> levels;
+  };
+  std::vector<shape_range> ranges;
+  std::vector<unsigned int> indices;
+  size_t levels = 0;
 
-    if(!shape.mesh.normals.empty()) {
-      // Generate and upload a buffer with texture coordinates to GPU
-      glGenBuffers(1, &buffer.nbo);
-      glBindBuffer(GL_ARRAY_BUFFER, buffer.nbo);
-      glBufferData(GL_ARRAY_BUFFER, shape.mesh.normals.size() * sizeof(float), shape.mesh.normals.data(),
-                   GL_STATIC_DRAW);
+  for(auto& shape : shapes) {
+    auto shapeVertices = shape.mesh.positions.size() / 3;
+    shape_range range{(GLint) (positions.size() / 3), {}};
+
+    positions.insert(positions.end(), shape.mesh.positions.begin(), shape.mesh.positions.end());
+    shapeBounds.push_back(computeBounds(shape.mesh.positions.data(), shapeVertices));
+    if (hasTexcoords) {
+      if (shape.mesh.texcoords.empty()) texcoords.resize(texcoords.size() + shapeVertices * 2, 0.0f);
+      else texcoords.insert(texcoords.end(), shape.mesh.texcoords.begin(), shape.mesh.texcoords.end());
+    }
+    if (hasNormals) {
+      if (shape.mesh.normals.empty()) normals.resize(normals.size() + shapeVertices * 3, 0.0f);
+      else normals.insert(normals.end(), shape.mesh.normals.begin(), shape.mesh.normals.end());
+    }
 
-      glEnableVertexAttribArray(2);
-      glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    // Generate levels of detail and append them to the shared index list
+    auto shapeLods = generateLods(shape.mesh.indices, shape.mesh.positions.data(), shapeVertices, lodLevels, lodRatio);
+    for (auto &lod : shapeLods) {
+      range.levels.emplace_back(indices.size(), lod.size());
+      indices.insert(indices.end(), lod.begin(), lod.end());
     }
+    levels = std::max(levels, shapeLods.size());
+    ranges.push_back(range);
+  }
+
+  if (ranges.empty()) return;
+  bounds = computeBounds(positions.data(), positions.size() / 3);
 
-    // Generate and upload a buffer with indices to GPU
-    glGenBuffers(1, &buffer.ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, shape.mesh.indices.size() * sizeof(unsigned int), shape.mesh.indices.data(), GL_STATIC_DRAW);
-    buffer.size = (GLsizei) shape.mesh.indices.size();
+  // Generate a vertex array object
+  glGenVertexArrays(1, &vao);
+  state::bindVertexArray(vao);
+
+  // Generate and upload a buffer with vertex positions to GPU
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+
+  // Bind the buffer to "Position" attribute in program
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+  if(hasTexcoords) {
+    // Generate and upload a buffer with texture coordinates to GPU
+    glGenBuffers(1, &tbo);
+    glBindBuffer(GL_ARRAY_BUFFER, tbo);
+    glBufferData(GL_ARRAY_BUFFER, texcoords.size() * sizeof(float), texcoords.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+  }
+
+  if(hasNormals) {
+    // Generate and upload a buffer with normals to GPU
+    glGenBuffers(1, &nbo);
+    glBindBuffer(GL_ARRAY_BUFFER, nbo);
+    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(float), normals.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+  }
 
-    // Copy it to the end of the buffers vector
-    buffers.push_back(buffer);
+  // Generate and upload a buffer with indices to GPU
+  glGenBuffers(1, &ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  if (maxShapeVertices <= 65536) {
+    // Shape relative indices of all shapes fit into 16 bits, halves the index buffer size
+    std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+    type = GL_UNSIGNED_SHORT;
+  } else {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    type = GL_UNSIGNED_INT;
+  }
+  size_t indexSize = type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(unsigned int);
+
+  // Build one draw batch per level of detail, shapes with fewer levels reuse their coarsest one
+  lods.resize(levels);
+  for (size_t level = 0; level < levels; level++) {
+    for (auto &range : ranges) {
+      auto &shapeLevel = range.levels[std::min(level, range.levels.size() - 1)];
+      lods[level].counts.push_back((GLsizei) shapeLevel.second);
+      lods[level].offsets.push_back(reinterpret_cast<const void *>(shapeLevel.first * indexSize));
+      lods[level].baseVertices.push_back(range.baseVertex);
+    }
   }
 }
 
 ppgso::Mesh_Tiny::~Mesh_Tiny() {
-  for(auto& buffer : buffers) {
-    glDeleteBuffers(1, &buffer.ibo);
-    glDeleteBuffers(1, &buffer.nbo);
-    glDeleteBuffers(1, &buffer.tbo);
-    glDeleteBuffers(1, &buffer.vbo);
-    glDeleteVertexArrays(1, &buffer.vao);
-  }
+  glDeleteBuffers(1, &ibo);
+  glDeleteBuffers(1, &nbo);
+  glDeleteBuffers(1, &tbo);
+  glDeleteBuffers(1, &vbo);
+  state::releaseVertexArray(vao);
+  glDeleteVertexArrays(1, &vao);
 }
 
-void ppgso::Mesh_Tiny::render() {
-  for(auto& buffer : buffers) {
-    // Draw object
-    glBindVertexArray(buffer.vao);
-    glDrawElements(GL_TRIANGLES, buffer.size, GL_UNSIGNED_INT, nullptr);
-  }
+void ppgso::Mesh_Tiny::render(int lod) {
+  if (lods.empty()) return;
+  auto &batch = lods[glm::clamp(lod, 0, (int) lods.size() - 1)];
+
+  // Draw all shapes with a single call
+  state::bindVertexArray(vao);
+  glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), type, batch.offsets.data(),
+                                (GLsizei) batch.counts.size(), batch.baseVertices.data());
+}
+
+int ppgso::Mesh_Tiny::selectLod(float distance, float lodDistance) const {
+  if (distance <= lodDistance) return 0;
+  auto lod = 1 + (int) std::log2(distance / lodDistance);
+  return std::min(lod, getLodCount() - 1);
+}
+
+int ppgso::Mesh_Tiny::getLodCount() const {
+  return std::max((int) lods.size(), 1);
+}
+
+size_t ppgso::Mesh_Tiny::getTriangleCount(int lod) const {
+  if (lods.empty()) return 0;
+  size_t triangles = 0;
+  for (auto count : lods[glm::clamp(lod, 0, (int) lods.size() - 1)].counts)
+    triangles += count / 3;
+  return triangles;
+}
+
+const ppgso::Bounds &ppgso::Mesh_Tiny::getBounds() const {
+  return bounds;
+}
+
+const std::vector<ppgso::Bounds> &ppgso::Mesh_Tiny::getShapeBounds() const {
+  return shapeBounds;
 }
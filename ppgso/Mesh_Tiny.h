@@ -12,18 +12,32 @@
 #include "shader.h"
 #include "texture.h"
 #include "tiny_obj_loader.h"
+#include "simplify.h"
+#include "bounds.h"
+#include "state.h"
 
 namespace ppgso {
 
   class Mesh_Tiny {
-    struct gl_buffer {
-    public:
-      GLuint vao, vbo, tbo, nbo, ibo = 0;
-      GLsizei size = 0;
+    // Arguments of a single glMultiDrawElementsBaseVertex call drawing every shape
+    struct draw_batch {
+      std::vector<GLsizei> counts;
+      std::vector<const void *> offsets;
+      std::vector<GLint> baseVertices;
     };
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
-    std::vector<gl_buffer> buffers;
+
+    // All shapes share the vertex and index buffers, indices are relative to the first vertex of their shape
+    GLuint vao = 0, vbo = 0, tbo = 0, nbo = 0, ibo = 0;
+    GLenum type = GL_UNSIGNED_INT;
+
+    // One batch per level of detail, level 0 is the full geometry
+    std::vector<draw_batch> lods;
+
+    // Bounds computed on load for the whole mesh and each of its shapes
+    Bounds bounds;
+    std::vector<Bounds> shapeBounds;
 
   public:
 
@@ -35,16 +49,63 @@ namespace ppgso {
      * vec2 TexCoord - Texture coordinate, position 1
      * vec3 Normal - Normal vector, position 2
      *
+     * Additional levels of detail are generated by quadric edge collapse simplification
+     * and stored in the same index buffer as the full geometry.
+     *
      * @param obj - File path to the obj file to load.
+     * @param lodLevels - Number of levels of detail to generate including the full geometry.
+     * @param lodRatio - Fraction of triangles kept from one level of detail to the next.
      */
-    Mesh_Tiny(const std::string &obj);
+    Mesh_Tiny(const std::string &obj, int lodLevels = 1, float lodRatio = 0.5f);
 
     ~Mesh_Tiny();
 
     /*!
-     * Render the geometry associated with the mesh using glDrawElements.
+     * Render the geometry of all shapes with a single glMultiDrawElementsBaseVertex call.
+     * Index type (16 or 32 bit) is chosen on load based on the vertex count of the largest shape.
+     *
+     * @param lod - Level of detail to render, clamped to the coarsest level available.
+     */
+    void render(int lod = 0);
+
+    /*!
+     * Select level of detail for an object at a distance from the camera.
+     * Level 0 is used up to lodDistance, each doubling of the distance past it selects the next coarser level.
+     *
+     * @param distance - Distance of the object from the camera, usually divided by the object scale.
+     * @param lodDistance - Distance up to which the full geometry is rendered.
+     * @return - Level of detail to pass to render.
+     */
+    int selectLod(float distance, float lodDistance) const;
+
+    /*!
+     * Get number of levels of detail generated for the mesh.
+     *
+     * @return - Number of levels including the full geometry.
+     */
+    int getLodCount() const;
+
+    /*!
+     * Get number of triangles rendered for a level of detail.
+     *
+     * @param lod - Level of detail, clamped to the coarsest level available.
+     * @return - Number of triangles over all shapes of the mesh.
+     */
+    size_t getTriangleCount(int lod = 0) const;
+
+    /*!
+     * Get bounding box and bounding sphere of the whole mesh in model space.
+     *
+     * @return - Bounds of all shapes.
+     */
+    const Bounds &getBounds() const;
+
+    /*!
+     * Get bounding box and bounding sphere of each shape in model space.
+     *
+     * @return - Bounds of the shapes in the order they were loaded.
      */
-    void render();
+    const std::vector<Bounds> &getShapeBounds() const;
   };
 }
 
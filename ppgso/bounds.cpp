@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cmath>
+
+#include "bounds.h"
+
+ppgso::Bounds ppgso::computeBounds(const float *positions, size_t vertexCount) {
+  Bounds bounds;
+  if (vertexCount == 0) return bounds;
+
+  // Min/max reduction, kept branch free so the compiler can vectorize it
+  glm::vec3 lo{positions[0], positions[1], positions[2]};
+  glm::vec3 hi = lo;
+  for (size_t i = 1; i < vertexCount; i++) {
+    glm::vec3 p{positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]};
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  bounds.min = lo;
+  bounds.max = hi;
+  bounds.center = (lo + hi) * 0.5f;
+
+  // Sphere around the box center reaching the farthest vertex
+  float radius2 = 0.0f;
+  for (size_t i = 0; i < vertexCount; i++) {
+    glm::vec3 d = glm::vec3{positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]} - bounds.center;
+    radius2 = std::max(radius2, glm::dot(d, d));
+  }
+  bounds.radius = std::sqrt(radius2);
+
+  return bounds;
+}
+
+ppgso::Bounds ppgso::mergeBounds(const Bounds &a, const Bounds &b) {
+  Bounds bounds;
+  bounds.min = glm::min(a.min, b.min);
+  bounds.max = glm::max(a.max, b.max);
+
+  // One sphere already contains the other
+  float distance = glm::length(b.center - a.center);
+  if (distance + b.radius <= a.radius) {
+    bounds.center = a.center;
+    bounds.radius = a.radius;
+  } else if (distance + a.radius <= b.radius) {
+    bounds.center = b.center;
+    bounds.radius = b.radius;
+  } else {
+    bounds.radius = (distance + a.radius + b.radius) * 0.5f;
+    bounds.center = a.center + (b.center - a.center) * ((bounds.radius - a.radius) / distance);
+  }
+
+  return bounds;
+}
+
+ppgso::Frustum ppgso::computeFrustum(const glm::mat4 &viewProjection) {
+  // Planes are sums and differences of the matrix rows
+  auto m = glm::transpose(viewProjection);
+  Frustum frustum;
+  frustum.planes[0] = m[3] + m[0];
+  frustum.planes[1] = m[3] - m[0];
+  frustum.planes[2] = m[3] + m[1];
+  frustum.planes[3] = m[3] - m[1];
+  frustum.planes[4] = m[3] + m[2];
+  frustum.planes[5] = m[3] - m[2];
+
+  for (auto &plane : frustum.planes)
+    plane /= glm::length(glm::vec3{plane});
+
+  return frustum;
+}
+
+bool ppgso::intersects(const Frustum &frustum, const glm::vec3 &min, const glm::vec3 &max) {
+  for (auto &plane : frustum.planes) {
+    // Box corner farthest along the plane normal
+    glm::vec3 corner{plane.x > 0 ? max.x : min.x,
+                     plane.y > 0 ? max.y : min.y,
+                     plane.z > 0 ? max.z : min.z};
+    if (glm::dot(glm::vec3{plane}, corner) + plane.w < 0) return false;
+  }
+  return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+namespace ppgso {
+
+  /*!
+   * Axis aligned bounding box and bounding sphere of geometry in model space.
+   */
+  struct Bounds {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+  };
+
+  /*!
+   * Compute the tight bounding box of vertex positions and a bounding sphere around its center.
+   *
+   * @param positions - Tightly packed xyz vertex positions.
+   * @param vertexCount - Number of vertices in positions.
+   * @return - Bounds of the vertices, empty bounds at origin when there are no vertices.
+   */
+  Bounds computeBounds(const float *positions, size_t vertexCount);
+
+  /*!
+   * Merge two bounds into bounds enclosing both.
+   *
+   * @param a - First bounds.
+   * @param b - Second bounds.
+   * @return - Union of the boxes and the smallest sphere enclosing both spheres.
+   */
+  Bounds mergeBounds(const Bounds &a, const Bounds &b);
+
+  /*!
+   * View frustum as six planes with normals pointing inside.
+   */
+  struct Frustum {
+    glm::vec4 planes[6];
+  };
+
+  /*!
+   * Extract frustum planes in world space from a camera.
+   *
+   * @param viewProjection - Projection matrix multiplied by view matrix.
+   * @return - Normalized frustum planes.
+   */
+  Frustum computeFrustum(const glm::mat4 &viewProjection);
+
+  /*!
+   * Test whether an axis aligned box is at least partially inside the frustum.
+   * Conservative, boxes near frustum corners may pass.
+   *
+   * @param frustum - Frustum to test against.
+   * @param min - Minimum corner of the box.
+   * @param max - Maximum corner of the box.
+   * @return - False when the box is completely outside.
+   */
+  bool intersects(const Frustum &frustum, const glm::vec3 &min, const glm::vec3 &max);
+}
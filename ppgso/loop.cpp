@@ -0,0 +1,49 @@
+#include "loop.h"
+
+ppgso::FixedTimestep::FixedTimestep(double step, int maxSteps) : step{step}, maxSteps{maxSteps} {}
+
+float ppgso::FixedTimestep::advance(double time, const std::function<void(float)> &update) {
+  // First frame only starts the clock
+  if (lastTime < 0) lastTime = time;
+  accumulator += time - lastTime;
+  lastTime = time;
+
+  int steps = 0;
+  while (accumulator >= step && steps < maxSteps) {
+    update((float) step);
+    accumulator -= step;
+    steps++;
+  }
+
+  // Drop time the simulation could not keep up with
+  if (accumulator >= step) accumulator = 0;
+
+  alpha = (float) (accumulator / step);
+  return alpha;
+}
+
+void ppgso::FixedTimestep::setFrameCap(double fps) {
+  if (fps > 0)
+    frameTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{1.0 / fps});
+  else
+    frameTime = std::chrono::steady_clock::duration{0};
+  nextFrame = std::chrono::steady_clock::now();
+}
+
+void ppgso::FixedTimestep::waitFrame() {
+  if (frameTime.count() == 0) return;
+
+  auto now = std::chrono::steady_clock::now();
+  if (nextFrame > now) std::this_thread::sleep_until(nextFrame);
+
+  // Schedule from the deadline to keep an even pace, restart after a missed frame
+  nextFrame = std::max(nextFrame + frameTime, now);
+}
+
+float ppgso::FixedTimestep::getStep() const {
+  return (float) step;
+}
+
+float ppgso::FixedTimestep::getAlpha() const {
+  return alpha;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ppgso {
+
+  /*!
+   * Fixed timestep loop driver.
+   * Simulation advances in constant steps independent of the frame rate, rendering interpolates
+   * between the last two steps using the factor returned by advance.
+   */
+  class FixedTimestep {
+  public:
+    /*!
+     * Create a loop driver.
+     *
+     * @param step - Simulation step in seconds.
+     * @param maxSteps - Maximum number of steps per frame, time beyond that is dropped so slow frames do not spiral.
+     */
+    explicit FixedTimestep(double step = 1.0 / 60.0, int maxSteps = 8);
+
+    /*!
+     * Advance the simulation to the given time.
+     *
+     * @param time - Current time in seconds, usually glfwGetTime().
+     * @param update - Called once for every step with the step length in seconds.
+     * @return - Interpolation factor in range [0, 1) between the previous and the last step.
+     */
+    float advance(double time, const std::function<void(float)> &update);
+
+    /*!
+     * Limit the frame rate, call waitFrame after presenting each frame.
+     *
+     * @param fps - Maximum frames per second, 0 for unlimited.
+     */
+    void setFrameCap(double fps);
+
+    /*!
+     * Sleep until the next frame may start according to the frame cap.
+     */
+    void waitFrame();
+
+    /*!
+     * Get simulation step.
+     *
+     * @return - Step in seconds.
+     */
+    float getStep() const;
+
+    /*!
+     * Get interpolation factor computed by the last advance.
+     *
+     * @return - Factor in range [0, 1).
+     */
+    float getAlpha() const;
+
+  private:
+    double step;
+    int maxSteps;
+    double accumulator = 0;
+    double lastTime = -1;
+    float alpha = 0;
+    std::chrono::steady_clock::duration frameTime{0};
+    std::chrono::steady_clock::time_point nextFrame;
+  };
+
+  /*!
+   * Run a fixed timestep simulation on its own thread.
+   * The thread updates a private copy of the state and publishes it after every step, the render thread
+   * reads the last two published states and interpolates between them. Update must not call OpenGL
+   * since the context is current only on the render thread.
+   *
+   * @tparam State - Copyable simulation state.
+   */
+  template<typename State>
+  class SimulationThread {
+  public:
+    /*!
+     * Start the simulation.
+     *
+     * @param initial - Initial state.
+     * @param update - Advance the state by the step given in seconds.
+     * @param step - Simulation step in seconds.
+     */
+    SimulationThread(const State &initial, std::function<void(State &, float)> update, double step = 1.0 / 60.0)
+            : previous{initial}, current{initial}, update{std::move(update)}, step{step} {
+      published = std::chrono::steady_clock::now();
+      thread = std::thread{&SimulationThread::run, this, initial};
+    }
+
+    ~SimulationThread() {
+      {
+        std::lock_guard<std::mutex> lock{mutex};
+        running = false;
+      }
+      stopped.notify_one();
+      thread.join();
+    }
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    /*!
+     * Copy the last two published states.
+     *
+     * @param previousState - State one step before the current one.
+     * @param currentState - Last published state.
+     * @return - Interpolation factor in range [0, 1] of the present time between the two states.
+     */
+    float read(State &previousState, State &currentState) {
+      std::lock_guard<std::mutex> lock{mutex};
+      previousState = previous;
+      currentState = current;
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - published;
+      return (float) std::min(elapsed.count() / step, 1.0);
+    }
+
+    /*!
+     * Modify the simulated state from another thread, e.g. to pass input. Applied before the next step.
+     *
+     * @param change - Function modifying the state.
+     */
+    void post(std::function<void(State &)> change) {
+      std::lock_guard<std::mutex> lock{mutex};
+      changes.push_back(std::move(change));
+    }
+
+  private:
+    void run(State state) {
+      auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{step});
+      auto next = std::chrono::steady_clock::now();
+      std::vector<std::function<void(State &)>> pending;
+
+      std::unique_lock<std::mutex> lock{mutex};
+      while (running) {
+        // Simulate outside of the lock so readers never wait for a step
+        pending.swap(changes);
+        lock.unlock();
+        for (auto &change : pending) change(state);
+        pending.clear();
+        update(state, (float) step);
+        lock.lock();
+
+        previous = std::move(current);
+        current = state;
+        published = std::chrono::steady_clock::now();
+
+        // Do not try to catch up after a stall
+        next = std::max(next + interval, std::chrono::steady_clock::now());
+        stopped.wait_until(lock, next, [this] { return !running; });
+      }
+    }
+
+    State previous, current;
+    std::function<void(State &, float)> update;
+    std::vector<std::function<void(State &)>> changes;
+    double step;
+    std::chrono::steady_clock::time_point published;
+    bool running = true;
+    std::mutex mutex;
+    std::condition_variable stopped;
+    std::thread thread;
+  };
+}
@@ -18,6 +18,12 @@ namespace ppgso {
 #endif
 }
 
+#include "simplify.h"
+#include "bounds.h"
+#include "state.h"
+#include "profiler.h"
+#include "loop.h"
+#include "uniform_buffer.h"
 #include "shader.h"
 #include "image.h"
 #include "image_bmp.h"
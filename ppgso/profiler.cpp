@@ -0,0 +1,166 @@
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "profiler.h"
+
+namespace ppgso {
+  namespace profiler {
+
+    // Frames recorded before their queries are read back, enough for the GPU to catch up
+    const int LATENCY = 4;
+
+    using clock = std::chrono::steady_clock;
+
+    struct section_record {
+      std::string name;
+      int depth;
+      clock::time_point start;
+      double cpu;
+    };
+
+    struct frame_record {
+      std::vector<section_record> sections;
+      // Timestamp queries at the beginning and the end of each section
+      std::vector<GLuint> queries;
+      // Query issued last, timestamps complete in order so all results are available once it is
+      GLuint last = 0;
+      unsigned long number = 0;
+      bool recorded = false;
+    };
+
+    static frame_record frames[LATENCY];
+    static int current = 0;
+    static unsigned long frameNumber = 0;
+    static std::vector<size_t> open;
+
+    static bool enabled = false, requested = false;
+    static int consoleInterval = 60;
+    static std::ofstream csv;
+    static std::vector<Section> report;
+
+    Scope::Scope(const std::string &name) {
+      begin(name);
+    }
+
+    Scope::~Scope() {
+      end();
+    }
+
+    void begin(const std::string &name) {
+      if (!enabled) return;
+      auto &frame = frames[current];
+
+      auto index = frame.sections.size();
+      if (frame.queries.size() < (index + 1) * 2) {
+        frame.queries.resize((index + 1) * 2);
+        glGenQueries(2, &frame.queries[index * 2]);
+      }
+      glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+      frame.last = frame.queries[index * 2];
+
+      frame.sections.push_back({name, (int) open.size(), clock::now(), 0.0});
+      open.push_back(index);
+    }
+
+    void end() {
+      if (!enabled || open.empty()) return;
+      auto &frame = frames[current];
+
+      auto index = open.back();
+      open.pop_back();
+      glQueryCounter(frame.queries[index * 2 + 1], GL_TIMESTAMP);
+      frame.last = frame.queries[index * 2 + 1];
+
+      auto &section = frame.sections[index];
+      section.cpu = std::chrono::duration<double, std::milli>(clock::now() - section.start).count();
+    }
+
+    // Read back timings of a recorded frame when all its queries finished
+    static bool collect(frame_record &frame) {
+      if (frame.sections.empty()) return false;
+
+      GLint available = GL_FALSE;
+      glGetQueryObjectiv(frame.last, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (available == GL_FALSE) return false;
+
+      report.clear();
+      for (size_t i = 0; i < frame.sections.size(); i++) {
+        GLuint64 start = 0, stop = 0;
+        glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &stop);
+        auto &section = frame.sections[i];
+        report.push_back({section.name, section.depth, section.cpu, (double) (stop - start) / 1e6});
+      }
+      return true;
+    }
+
+    static void print(unsigned long number) {
+      if (consoleInterval > 0 && number % consoleInterval == 0) {
+        std::cout << "Frame " << number << std::endl;
+        for (auto &section : report) {
+          std::cout << std::string((unsigned long) section.depth * 2 + 2, ' ') << std::left << std::setw(20)
+                    << section.name << std::right << std::fixed << std::setprecision(3)
+                    << " cpu " << std::setw(8) << section.cpu << " ms"
+                    << " gpu " << std::setw(8) << section.gpu << " ms" << std::endl;
+        }
+      }
+
+      if (csv.is_open()) {
+        for (auto &section : report)
+          csv << number << "," << section.name << "," << section.depth << ","
+              << section.cpu << "," << section.gpu << "\n";
+      }
+    }
+
+    void endFrame() {
+      if (enabled) {
+        // Close sections left open so the next frame starts clean
+        while (!open.empty()) end();
+        frames[current].number = frameNumber;
+        frames[current].recorded = true;
+
+        // The oldest frame is reused next, report it unless the GPU is still behind
+        current = (current + 1) % LATENCY;
+        auto &oldest = frames[current];
+        if (oldest.recorded && collect(oldest)) print(oldest.number);
+        oldest.sections.clear();
+        oldest.recorded = false;
+      }
+
+      frameNumber++;
+      if (requested == enabled) return;
+
+      // Apply enabling between frames, recorded frames are dropped when disabled
+      enabled = requested;
+      for (auto &frame : frames) {
+        frame.sections.clear();
+        frame.recorded = false;
+      }
+    }
+
+    void setEnabled(bool enable) {
+      requested = enable;
+    }
+
+    bool isEnabled() {
+      return requested;
+    }
+
+    void setConsoleInterval(int frames) {
+      consoleInterval = frames;
+    }
+
+    void setCsvFile(const std::string &file) {
+      if (csv.is_open()) csv.close();
+      if (file.empty()) return;
+      csv.open(file);
+      csv << "frame,section,depth,cpu_ms,gpu_ms\n";
+    }
+
+    const std::vector<Section> &getReport() {
+      return report;
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace ppgso {
+  namespace profiler {
+
+    /*!
+     * Timing of a named section in a finished frame, nested sections have higher depth.
+     */
+    struct Section {
+      std::string name;
+      int depth;
+      double cpu;   // CPU time in milliseconds
+      double gpu;   // GPU time in milliseconds
+    };
+
+    /*!
+     * Time the enclosing block on CPU and GPU.
+     */
+    class Scope {
+    public:
+      /*!
+       * Begin a section that ends when the scope is left.
+       *
+       * @param name - Section name shown in the report.
+       */
+      explicit Scope(const std::string &name);
+
+      ~Scope();
+
+      Scope(const Scope &) = delete;
+      Scope &operator=(const Scope &) = delete;
+    };
+
+    /*!
+     * Begin a named section, sections may nest.
+     * GPU time is measured with timestamp queries read a few frames later to avoid stalls.
+     *
+     * @param name - Section name shown in the report.
+     */
+    void begin(const std::string &name);
+
+    /*!
+     * End the last section started by begin.
+     */
+    void end();
+
+    /*!
+     * Finish the frame and collect timings of an older frame whose queries are available.
+     * Called by Window::pollEvents, applications with their own loop call it before swapping buffers.
+     */
+    void endFrame();
+
+    /*!
+     * Enable or disable profiling, takes effect at the end of the frame.
+     *
+     * @param enabled - True to time sections.
+     */
+    void setEnabled(bool enabled);
+
+    /*!
+     * Get whether profiling is enabled.
+     *
+     * @return - True when sections are timed.
+     */
+    bool isEnabled();
+
+    /*!
+     * Print the report to console every "frames" frames.
+     *
+     * @param frames - Number of frames between reports, 0 disables printing.
+     */
+    void setConsoleInterval(int frames);
+
+    /*!
+     * Append the report of every frame to a CSV file with columns frame,section,depth,cpu_ms,gpu_ms.
+     *
+     * @param file - Path of the CSV file, empty string stops writing.
+     */
+    void setCsvFile(const std::string &file);
+
+    /*!
+     * Get timings of the last frame collected.
+     *
+     * @return - Sections in the order they were started.
+     */
+    const std::vector<Section> &getReport();
+  }
+}
@@ -1,5 +1,11 @@
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <map>
 #include <sstream>
+#include <vector>
+#include <sys/stat.h>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -9,24 +15,81 @@
 #include "shader.h"
 
 
-ppgso::Shader::Shader(const std::string &vertex_shader_code, const std::string &fragment_shader_code) {
+// Feature defines inserted after the #version line by add_resources
+static std::string featureDefines(const std::string &code) {
+  std::string defines;
+  auto line = code.find('\n');
+  while (line != std::string::npos && code.compare(line + 1, 8, "#define ") == 0) {
+    auto end = code.find('\n', line + 1);
+    defines += code.substr(line + 1, end == std::string::npos ? std::string::npos : end - line);
+    line = end;
+  }
+  return defines;
+}
+
+ppgso::Shader::Shader(const std::string &vertex_shader_code, const std::string &fragment_shader_code, bool deferred) {
+  vertexDefines = featureDefines(vertex_shader_code);
+  fragmentDefines = featureDefines(fragment_shader_code);
+
+  // Skip compilation when the program binary is cached
+  cacheFile = getCacheFile(vertex_shader_code, fragment_shader_code);
+  if (loadBinary(cacheFile)) {
+    cacheUniforms();
+    if (!deferred) use();
+    return;
+  }
+
+  // Let the driver compile on as many threads as it likes when supported
+  static bool threads_set = false;
+  if (!threads_set && GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+  threads_set = true;
+
   // Create shaders
-  auto vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-  auto fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-  auto result = GL_FALSE;
-  auto info_length = 0;
+  vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
   // Compile vertex shader
   auto vertex_shader_code_ptr = vertex_shader_code.c_str();
-  glShaderSource(vertex_shader_id, 1, &vertex_shader_code_ptr, nullptr);
-  glCompileShader(vertex_shader_id);
+  glShaderSource(vertexShader, 1, &vertex_shader_code_ptr, nullptr);
+  glCompileShader(vertexShader);
+
+  // Compile fragment shader
+  auto fragment_shader_code_ptr = fragment_shader_code.c_str();
+  glShaderSource(fragmentShader, 1, &fragment_shader_code_ptr, nullptr);
+  glCompileShader(fragmentShader);
+
+  // Create and link the program, compile status is only checked once the link is finished
+  program = glCreateProgram();
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glBindFragDataLocation(program, 0, "FragmentColor");
+  if (!cacheFile.empty()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program);
+  pending = true;
+
+  if (!deferred) use();
+}
+
+bool ppgso::Shader::isReady() const {
+  if (!pending || !GLEW_ARB_parallel_shader_compile) return true;
+  auto result = GL_FALSE;
+  glGetProgramiv(program, GL_COMPLETION_STATUS_ARB, &result);
+  return result == GL_TRUE;
+}
+
+void ppgso::Shader::finish() const {
+  if (!pending) return;
+  pending = false;
+
+  auto result = GL_FALSE;
+  auto info_length = 0;
 
   // Check vertex shader log
-  glGetShaderiv(vertex_shader_id, GL_COMPILE_STATUS, &result);
+  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &result);
   if (result == GL_FALSE) {
-    glGetShaderiv(vertex_shader_id, GL_INFO_LOG_LENGTH, &info_length);
+    glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &info_length);
     std::string vertex_shader_log((unsigned int) info_length, ' ');
-    glGetShaderInfoLog(vertex_shader_id, info_length, nullptr,
+    glGetShaderInfoLog(vertexShader, info_length, nullptr,
                        &vertex_shader_log[0]);
     std::stringstream msg;
     msg << "Error Compiling Vertex Shader ..." << std::endl;
@@ -34,17 +97,12 @@ ppgso::Shader::Shader(const std::string &vertex_shader_code, const std::string &
     throw std::runtime_error(msg.str());
   }
 
-  // Compile fragment shader
-  auto fragment_shader_code_ptr = fragment_shader_code.c_str();
-  glShaderSource(fragment_shader_id, 1, &fragment_shader_code_ptr, nullptr);
-  glCompileShader(fragment_shader_id);
-
   // Check fragment shader log
-  glGetShaderiv(fragment_shader_id, GL_COMPILE_STATUS, &result);
+  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &result);
   if (result == GL_FALSE) {
-    glGetShaderiv(fragment_shader_id, GL_INFO_LOG_LENGTH, &info_length);
+    glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &info_length);
     std::string fragment_shader_log((unsigned long) info_length, ' ');
-    glGetShaderInfoLog(fragment_shader_id, info_length, nullptr,
+    glGetShaderInfoLog(fragmentShader, info_length, nullptr,
                        &fragment_shader_log[0]);
     std::stringstream msg;
     msg << "Error Compiling Fragment Shader ..." << std::endl;
@@ -52,92 +110,412 @@ ppgso::Shader::Shader(const std::string &vertex_shader_code, const std::string &
     throw std::runtime_error(msg.str());
   }
 
-  // Create and link the program
-  auto program_id = glCreateProgram();
-  glAttachShader(program_id, vertex_shader_id);
-  glAttachShader(program_id, fragment_shader_id);
-  glBindFragDataLocation(program_id, 0, "FragmentColor");
-  glLinkProgram(program_id);
-
   // Check program log
-  glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+  glGetProgramiv(program, GL_LINK_STATUS, &result);
   if (result == GL_FALSE) {
-    glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_length);
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_length);
     std::string program_log((unsigned long) info_length, ' ');
-    glGetProgramInfoLog(program_id, info_length, nullptr, &program_log[0]);
+    glGetProgramInfoLog(program, info_length, nullptr, &program_log[0]);
     std::stringstream msg;
     msg << "Error Linking Shader Program ..." << std::endl;
     msg << program_log;
     throw std::runtime_error(msg.str());
   }
-  glDeleteShader(vertex_shader_id);
-  glDeleteShader(fragment_shader_id);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+  vertexShader = fragmentShader = 0;
+
+  saveBinary(cacheFile);
+  cacheUniforms();
+}
+
+std::string ppgso::Shader::cacheDirectory = "shader_cache";
+
+bool ppgso::Shader::hotReload = false;
+std::set<ppgso::Shader *> ppgso::Shader::watched;
+
+void ppgso::Shader::watch(const std::string &vertex_file, const std::string &fragment_file) {
+#ifdef PPGSO_SHADER_DIR
+  vertexFile = std::string{PPGSO_SHADER_DIR} + "/" + vertex_file;
+  fragmentFile = std::string{PPGSO_SHADER_DIR} + "/" + fragment_file;
+#else
+  vertexFile = vertex_file;
+  fragmentFile = fragment_file;
+#endif
+  vertexTime = fragmentTime = 0;
+  watched.insert(this);
+}
+
+void ppgso::Shader::setHotReload(bool enabled) {
+  hotReload = enabled;
+}
+
+bool ppgso::Shader::getHotReload() {
+  return hotReload;
+}
+
+void ppgso::Shader::reloadChanged() {
+  if (!hotReload) return;
+  for (auto shader : watched) shader->reload();
+}
+
+// Modification time of a file, 0 when it does not exist
+static std::time_t modificationTime(const std::string &file) {
+  struct stat info;
+  if (stat(file.c_str(), &info) != 0) return 0;
+  return info.st_mtime;
+}
+
+// Read a source file and define the features of the embedded source after its #version line
+static bool readSource(const std::string &file, const std::string &defines, std::string &code) {
+  std::ifstream stream{file};
+  if (!stream) return false;
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  code = buffer.str();
+  auto line = code.find('\n');
+  if (!defines.empty() && line != std::string::npos) code.insert(line + 1, defines);
+  return true;
+}
+
+// Type and array size of the active uniforms with a location, uniform block members are left out
+static std::map<std::string, std::pair<GLenum, GLint>> activeUniforms(GLuint program) {
+  std::map<std::string, std::pair<GLenum, GLint>> result;
+  GLint count = 0, max_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::string buffer((unsigned long) max_length, ' ');
+  for (GLuint i = 0; i < (GLuint) count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type;
+    glGetActiveUniform(program, i, max_length, &length, &size, &type, &buffer[0]);
+    std::string name = buffer.substr(0, (unsigned long) length);
+    if (glGetUniformLocation(program, name.c_str()) >= 0) result[name] = {type, size};
+  }
+  return result;
+}
+
+// Copy values of the uniforms both programs declare with the same type, the target program must be in use
+static void copyUniforms(GLuint from, GLuint to) {
+  auto target = activeUniforms(to);
+  for (auto &uniform : activeUniforms(from)) {
+    auto match = target.find(uniform.first);
+    if (match == target.end() || match->second.first != uniform.second.first) continue;
+
+    // Arrays are reported as "name[0]", copy the elements both programs have
+    auto name = uniform.first;
+    auto bracket = name.rfind("[0]");
+    auto array = bracket != std::string::npos && bracket + 3 == name.size();
+    auto elements = std::min(uniform.second.second, match->second.second);
+    for (GLint element = 0; element < elements; element++) {
+      auto element_name = array ? name.substr(0, bracket) + "[" + std::to_string(element) + "]" : name;
+      auto source = glGetUniformLocation(from, element_name.c_str());
+      auto destination = glGetUniformLocation(to, element_name.c_str());
+      if (source < 0 || destination < 0) continue;
+
+      // Large enough for a mat4
+      GLfloat f[16];
+      GLint i[4];
+      GLuint u[4];
+      switch (uniform.second.first) {
+        case GL_FLOAT: glGetUniformfv(from, source, f); glUniform1fv(destination, 1, f); break;
+        case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glUniform2fv(destination, 1, f); break;
+        case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glUniform3fv(destination, 1, f); break;
+        case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glUniform4fv(destination, 1, f); break;
+        case GL_FLOAT_MAT2: glGetUniformfv(from, source, f); glUniformMatrix2fv(destination, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3: glGetUniformfv(from, source, f); glUniformMatrix3fv(destination, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glUniformMatrix4fv(destination, 1, GL_FALSE, f); break;
+        case GL_INT:
+        case GL_BOOL: glGetUniformiv(from, source, i); glUniform1iv(destination, 1, i); break;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2: glGetUniformiv(from, source, i); glUniform2iv(destination, 1, i); break;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3: glGetUniformiv(from, source, i); glUniform3iv(destination, 1, i); break;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4: glGetUniformiv(from, source, i); glUniform4iv(destination, 1, i); break;
+        case GL_UNSIGNED_INT: glGetUniformuiv(from, source, u); glUniform1uiv(destination, 1, u); break;
+        case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glUniform2uiv(destination, 1, u); break;
+        case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glUniform3uiv(destination, 1, u); break;
+        case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glUniform4uiv(destination, 1, u); break;
+        // Remaining types used by the samples are samplers, which hold a texture unit
+        default: glGetUniformiv(from, source, i); glUniform1iv(destination, 1, i); break;
+      }
+    }
+  }
+}
+
+void ppgso::Shader::reload() {
+  // Swap in the recompiled program once the driver finished it
+  if (reloaded) {
+    if (!reloaded->isReady()) return;
+    try {
+      reloaded->finish();
+    } catch (std::exception &e) {
+      std::cerr << "Failed to reload " << fragmentFile << std::endl << e.what() << std::endl;
+      reloaded.reset();
+      return;
+    }
+    // Uniforms set only once, like sampler units and constants, keep their values in the new program
+    state::useProgram(reloaded->program);
+    copyUniforms(program, reloaded->program);
+
+    state::releaseProgram(program);
+    std::swap(program, reloaded->program);
+    std::swap(uniforms, reloaded->uniforms);
+    std::swap(blockMembers, reloaded->blockMembers);
+    reloaded.reset();
+    std::cout << "Reloaded " << vertexFile << ", " << fragmentFile << std::endl;
+    return;
+  }
+
+  // The first check only records the current state of the files
+  auto vertex_time = modificationTime(vertexFile);
+  auto fragment_time = modificationTime(fragmentFile);
+  if (vertex_time == vertexTime && fragment_time == fragmentTime) return;
+  auto first = vertexTime == 0 && fragmentTime == 0;
+  vertexTime = vertex_time;
+  fragmentTime = fragment_time;
+  if (first) return;
+
+  std::string vertex_shader_code, fragment_shader_code;
+  if (!readSource(vertexFile, vertexDefines, vertex_shader_code)) return;
+  if (!readSource(fragmentFile, fragmentDefines, fragment_shader_code)) return;
+
+  // Compile in the background, edited sources are not worth caching
+  reloaded = std::make_shared<Shader>(vertex_shader_code, fragment_shader_code, true);
+  reloaded->cacheFile.clear();
+}
+
+void ppgso::Shader::setCacheDirectory(const std::string &directory) {
+  cacheDirectory = directory;
+}
+
+std::string ppgso::Shader::getCacheFile(const std::string &vertex_shader_code, const std::string &fragment_shader_code) {
+  if (cacheDirectory.empty()) return "";
+
+  // Program binaries need ARB_get_program_binary and at least one binary format
+  static auto supported = [] {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+  }();
+  if (!supported) return "";
+
+  // Binaries are only valid for the same driver, hash it together with the sources (64-bit FNV-1a)
+  unsigned long long hash = 14695981039346656037ull;
+  auto add = [&hash](const std::string &text) {
+    for (auto c : text) {
+      hash ^= (unsigned char) c;
+      hash *= 1099511628211ull;
+    }
+    hash ^= 0xff;
+    hash *= 1099511628211ull;
+  };
+  add(vertex_shader_code);
+  add(fragment_shader_code);
+  add((const char *) glGetString(GL_VENDOR));
+  add((const char *) glGetString(GL_RENDERER));
+  add((const char *) glGetString(GL_VERSION));
+
+  std::stringstream file;
+  file << cacheDirectory << "/" << std::hex << hash << ".bin";
+  return file.str();
+}
+
+bool ppgso::Shader::loadBinary(const std::string &cache_file) {
+  if (cache_file.empty()) return false;
+  std::ifstream file{cache_file, std::ios::binary};
+  if (!file) return false;
+
+  GLenum format = 0;
+  file.read((char *) &format, sizeof(format));
+  if (!file) return false;
+  std::vector<char> binary{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  if (binary.empty()) return false;
+
+  // The driver may still reject the binary, compile from source in that case
+  auto program_id = glCreateProgram();
+  glProgramBinary(program_id, format, binary.data(), (GLsizei) binary.size());
+  auto result = GL_FALSE;
+  glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+  if (result == GL_FALSE) {
+    glDeleteProgram(program_id);
+    return false;
+  }
 
   program = program_id;
-  use();
+  return true;
+}
+
+void ppgso::Shader::saveBinary(const std::string &cache_file) const {
+  if (cache_file.empty()) return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return;
+
+  GLenum format = 0;
+  std::vector<char> binary((unsigned long) length);
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  // Missing cache directory silently disables caching
+  std::ofstream file{cache_file, std::ios::binary};
+  file.write((const char *) &format, sizeof(format));
+  file.write(binary.data(), length);
 }
 
 ppgso::Shader::~Shader() {
+  watched.erase(this);
+
+  // Shaders of a program that never finished linking are still attached
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+  state::releaseProgram(program);
   glDeleteProgram( program );
 }
 
+void ppgso::Shader::cacheUniforms() const {
+  // Bind uniform blocks so buffers of the same block name are shared by all programs
+  GLint block_count = 0, block_max_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &block_max_length);
+  std::vector<std::string> blocks;
+  std::vector<GLint> block_sizes;
+  for (GLuint i = 0; i < (GLuint) block_count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    std::string name((unsigned long) block_max_length, ' ');
+    glGetActiveUniformBlockName(program, i, block_max_length, &length, &name[0]);
+    glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    name.resize((unsigned long) length);
+    glUniformBlockBinding(program, i, UniformBuffer::getBindingPoint(name));
+    blocks.push_back(name);
+    block_sizes.push_back(size);
+  }
+
+  GLint count = 0, max_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  std::string buffer((unsigned long) max_length, ' ');
+
+  for (GLuint i = 0; i < (GLuint) count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type;
+    glGetActiveUniform(program, i, max_length, &length, &size, &type, &buffer[0]);
+    std::string name = buffer.substr(0, (unsigned long) length);
+
+    // Uniforms in uniform blocks have no location, remember where they are stored instead
+    auto location = glGetUniformLocation(program, name.c_str());
+    if (location < 0) {
+      GLint block = -1, offset = 0;
+      glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &block);
+      glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_OFFSET, &offset);
+      if (block >= 0) blockMembers[name] = {blocks[block], offset, block_sizes[block]};
+      continue;
+    }
+    uniforms[name] = location;
+
+    // Arrays are reported as "name[0]", make the plain name and all elements available too
+    auto bracket = name.rfind("[0]");
+    if (bracket == std::string::npos || bracket + 3 != name.size()) continue;
+    auto base = name.substr(0, bracket);
+    uniforms[base] = location;
+    for (GLint element = 1; element < size; element++) {
+      auto element_name = base + "[" + std::to_string(element) + "]";
+      uniforms[element_name] = glGetUniformLocation(program, element_name.c_str());
+    }
+  }
+}
+
 void ppgso::Shader::use() const {
-  glUseProgram(program);
+  finish();
+  state::useProgram(program);
 }
 
 GLuint ppgso::Shader::getAttribLocation(const std::string &name) const {
-  use();
+  finish();
   return (GLuint) glGetAttribLocation(program, name.c_str());
 }
 
 GLuint ppgso::Shader::getUniformLocation(const std::string &name) const {
-  use();
-  return (GLuint) glGetUniformLocation(program, name.c_str());
+  finish();
+  auto uniform = uniforms.find(name);
+  if (uniform == uniforms.end()) return (GLuint) -1;
+  return (GLuint) uniform->second;
+}
+
+void ppgso::Shader::setBlockUniform(const std::string &name, const void *data, GLsizeiptr size) const {
+  auto member = blockMembers.find(name);
+  if (member == blockMembers.end()) return;
+
+  // Prefer the buffer bound by the application, create one for the block otherwise
+  auto &block = member->second.block;
+  auto buffer = UniformBuffer::getBound(block);
+  if (!buffer) {
+    auto &owned = blockBuffers[block];
+    owned = std::make_shared<UniformBuffer>(block, member->second.blockSize);
+    buffer = owned.get();
+  }
+  buffer->update(data, size, member->second.offset);
 }
 
 void ppgso::Shader::setUniform(const std::string &name, const Texture &texture, const int id) const {
   use();
-  auto uniform = getUniformLocation(name.c_str());
+  auto uniform = getUniformLocation(name);
   glUniform1i(uniform, id);
   texture.bind(id);
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::mat4 matrix) const {
+  auto uniform = getUniformLocation(name);
+  if (uniform == (GLuint) -1) return setBlockUniform(name, value_ptr(matrix), sizeof(matrix));
   use();
-  auto uniform = getUniformLocation(name.c_str());
   glUniformMatrix4fv(uniform, 1, GL_FALSE, value_ptr(matrix));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::mat3 matrix) const {
+  auto uniform = getUniformLocation(name);
+  if (uniform == (GLuint) -1) {
+    // std140 stores mat3 columns padded to vec4
+    glm::mat4 padded{matrix};
+    return setBlockUniform(name, value_ptr(padded), 3 * sizeof(glm::vec4));
+  }
   use();
-  auto uniform = getUniformLocation(name.c_str());
   glUniformMatrix3fv(uniform, 1, GL_FALSE, value_ptr(matrix));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, float value) const {
+  auto uniform = getUniformLocation(name);
+  if (uniform == (GLuint) -1) return setBlockUniform(name, &value, sizeof(value));
   use();
-  auto uniform = getUniformLocation(name.c_str());
   glUniform1f(uniform, value);
 }
 
 GLuint ppgso::Shader::getProgram() const {
+  finish();
   return program;
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::vec2 vector) const {
+  auto uniform = getUniformLocation(name);
+  if (uniform == (GLuint) -1) return setBlockUniform(name, value_ptr(vector), sizeof(vector));
   use();
-  auto uniform = getUniformLocation(name.c_str());
   glUniform2fv(uniform, 1, value_ptr(vector));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::vec3 vector) const {
+  auto uniform = getUniformLocation(name);
+  if (uniform == (GLuint) -1) return setBlockUniform(name, value_ptr(vector), sizeof(vector));
   use();
-  auto uniform = getUniformLocation(name.c_str());
   glUniform3fv(uniform, 1, value_ptr(vector));
 }
 
 void ppgso::Shader::setUniform(const std::string &name, glm::vec4 vector) const {
+  auto uniform = getUniformLocation(name);
+  if (uniform == (GLuint) -1) return setBlockUniform(name, value_ptr(vector), sizeof(vector));
   use();
-  auto uniform = getUniformLocation(name.c_str());
   glUniform4fv(uniform, 1, value_ptr(vector));
 }
@@ -1,11 +1,17 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <set>
+#include <ctime>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include "texture.h"
+#include "uniform_buffer.h"
+#include "state.h"
 
 namespace ppgso {
 
@@ -14,16 +20,94 @@ namespace ppgso {
 
     /*!
      * Compile and manage an GLSL program and its inputs.
+     * Uniform blocks are bound to the binding point shared by all blocks of the same name,
+     * see UniformBuffer.
+     *
+     * Linked programs are stored in the shader cache directory when the driver supports program binaries,
+     * later runs load the binary instead of compiling when the sources and the driver did not change.
+     *
+     * Deferred shaders only submit the sources to the driver, create all of them up front so the driver
+     * can compile them in parallel (ARB_parallel_shader_compile). Compile and link errors are reported
+     * on first use.
      *
      * @param vertex_shader_code - String containing the source of the vertex shader.
      * @param fragment_shader_code - String containing the source of the fragment shader.
+     * @param deferred - Do not wait for compilation and do not use the program yet.
      */
-    Shader(const std::string &vertex_shader_code, const std::string &fragment_shader_code);
+    Shader(const std::string &vertex_shader_code, const std::string &fragment_shader_code, bool deferred = false);
 
     ~Shader();
 
+    /*!
+     * Select a shader variant generated for a "// @features" line by add_resources.
+     *
+     * @param variants - The generated xxx_glsl_variants array.
+     * @param features - Bitmask of the generated XXX_GLSL_FEATURE constants.
+     * @return - Source with the requested features defined.
+     */
+    template<size_t N>
+    static const std::string &variant(const std::string (&variants)[N], unsigned int features) {
+      if (features >= N) throw std::runtime_error("Shader variant with unknown features requested!");
+      return variants[features];
+    }
+
+    /*!
+     * Set the directory used to store linked program binaries.
+     * The directory is expected to exist, caching is disabled when it is empty or not writable.
+     *
+     * @param directory - Directory path, "shader_cache" in the working directory by default.
+     */
+    static void setCacheDirectory(const std::string &directory);
+
+    /*!
+     * Watch GLSL source files of the program for changes during development.
+     * Files are resolved in the shader source directory of the build (PPGSO_SHADER_DIR),
+     * features defined in the embedded sources are defined in the reloaded sources too.
+     * The reloaded program starts with the current values of the uniforms it shares with this one.
+     *
+     * @param vertex_file - File name of the vertex shader source, e.g. "terrain_vert.glsl".
+     * @param fragment_file - File name of the fragment shader source.
+     */
+    void watch(const std::string &vertex_file, const std::string &fragment_file);
+
+    /*!
+     * Enable or disable hot reload of watched shaders.
+     *
+     * @param enabled - True to reload shaders from their source files when they change.
+     */
+    static void setHotReload(bool enabled);
+
+    /*!
+     * Get whether hot reload of watched shaders is enabled.
+     *
+     * @return - True when watched shaders are reloaded.
+     */
+    static bool getHotReload();
+
+    /*!
+     * Recompile watched shaders with changed source files, call once per frame.
+     * New programs are compiled deferred and replace the old ones only after they link successfully,
+     * errors are printed and the old program is kept.
+     */
+    static void reloadChanged();
+
+    /*!
+     * Check whether a deferred program finished compiling without waiting for it.
+     * Always true when the driver can not report the completion status.
+     *
+     * @return - True when first use of the program will not block.
+     */
+    bool isReady() const;
+
+    /*!
+     * Wait for a deferred program to finish compiling and linking, called on first use.
+     * Throws when compilation or linking failed.
+     */
+    void finish() const;
+
     /*!
      * Set up the program for use in OpenGL state.
+     * The call is skipped when the program is already in use.
      */
     void use() const;
 
@@ -37,9 +121,10 @@ namespace ppgso {
 
     /*!
      * Get OpenGL uniform location for for the input specified by "name"
+     * Locations of all active uniforms are cached when the program is linked.
      *
      * @param name - Name of the shader program input variable.
-     * @return - OpenGL attribute location number.
+     * @return - OpenGL uniform location number, -1 when the program has no such uniform.
      */
     GLuint getUniformLocation(const std::string &name) const;
 
@@ -110,6 +195,80 @@ namespace ppgso {
 
   private:
     GLuint program;
+
+    // Shaders attached to a program that is still compiling
+    mutable GLuint vertexShader = 0, fragmentShader = 0;
+    mutable bool pending = false;
+    std::string cacheFile;
+
+    // Locations of active uniforms by name, filled on link
+    mutable std::unordered_map<std::string, GLint> uniforms;
+
+    // Uniform block members by name, set through the buffer bound for their block
+    struct block_member {
+      std::string block;
+      GLintptr offset;
+      GLsizeiptr blockSize;
+    };
+    mutable std::unordered_map<std::string, block_member> blockMembers;
+
+    // Buffers created for blocks set through setUniform while no buffer was bound, shared so shaders stay copyable
+    mutable std::unordered_map<std::string, std::shared_ptr<UniformBuffer>> blockBuffers;
+
+    // Directory with cached program binaries
+    static std::string cacheDirectory;
+
+    // Hot reload state, watched source files and the program replacing this one while it compiles
+    std::string vertexDefines, fragmentDefines;
+    std::string vertexFile, fragmentFile;
+    std::time_t vertexTime = 0, fragmentTime = 0;
+    std::shared_ptr<Shader> reloaded;
+    static bool hotReload;
+    static std::set<Shader *> watched;
+
+    /*!
+     * Check watched files of the program, start recompiling or swap in a finished program.
+     */
+    void reload();
+
+    /*!
+     * Get path of the cached binary for the sources compiled by the current driver.
+     *
+     * @param vertex_shader_code - Source of the vertex shader.
+     * @param fragment_shader_code - Source of the fragment shader.
+     * @return - Path of the cache file or empty string when caching is not available.
+     */
+    static std::string getCacheFile(const std::string &vertex_shader_code, const std::string &fragment_shader_code);
+
+    /*!
+     * Create the program from a cached binary.
+     *
+     * @param cache_file - Path of the cache file.
+     * @return - True when the binary was accepted by the driver.
+     */
+    bool loadBinary(const std::string &cache_file);
+
+    /*!
+     * Store the linked program in the cache.
+     *
+     * @param cache_file - Path of the cache file.
+     */
+    void saveBinary(const std::string &cache_file) const;
+
+    /*!
+     * Query all active uniforms and uniform blocks of the linked program,
+     * cache uniform locations and bind the blocks to their shared binding points.
+     */
+    void cacheUniforms() const;
+
+    /*!
+     * Write a member of a uniform block into the buffer bound for the block.
+     *
+     * @param name - Name of the uniform block member.
+     * @param data - Value in std140 layout.
+     * @param size - Size of the value in bytes.
+     */
+    void setBlockUniform(const std::string &name, const void *data, GLsizeiptr size) const;
   };
 
 }
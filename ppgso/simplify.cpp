@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <array>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "simplify.h"
+
+namespace ppgso {
+
+  // Symmetric 4x4 matrix measuring the sum of squared distances to a set of planes
+  struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+
+    void addPlane(const glm::dvec3 &n, double d, double weight) {
+      a00 += weight * n.x * n.x;
+      a01 += weight * n.x * n.y;
+      a02 += weight * n.x * n.z;
+      a11 += weight * n.y * n.y;
+      a12 += weight * n.y * n.z;
+      a22 += weight * n.z * n.z;
+      b0 += weight * n.x * d;
+      b1 += weight * n.y * d;
+      b2 += weight * n.z * d;
+      c += weight * d * d;
+    }
+
+    void add(const Quadric &q) {
+      a00 += q.a00; a01 += q.a01; a02 += q.a02;
+      a11 += q.a11; a12 += q.a12; a22 += q.a22;
+      b0 += q.b0; b1 += q.b1; b2 += q.b2;
+      c += q.c;
+    }
+
+    double error(const glm::dvec3 &p) const {
+      double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+                 + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+                 + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+      return e > 0.0 ? e : 0.0;
+    }
+  };
+
+  // Candidate collapse of position group "from" onto position group "to"
+  struct Collapse {
+    unsigned int from, to;
+    double cost;
+  };
+
+  // Border edges are kept in place much more strongly than interior surface
+  const double BORDER_WEIGHT = 10.0;
+
+  static unsigned long long edgeKey(unsigned int a, unsigned int b) {
+    if (a > b) std::swap(a, b);
+    return (static_cast<unsigned long long>(a) << 32) | b;
+  }
+
+  std::vector<unsigned int> simplify(const std::vector<unsigned int> &indices, const float *positions,
+                                     size_t vertexCount, size_t targetIndexCount) {
+    return simplify(indices.data(), indices.size(), positions, vertexCount, targetIndexCount);
+  }
+
+  std::vector<unsigned int> simplify(const unsigned int *indices, size_t indexCount, const float *positions,
+                                     size_t vertexCount, size_t targetIndexCount) {
+    std::vector<unsigned int> result(indices, indices + indexCount);
+    if (result.size() <= targetIndexCount || vertexCount == 0) return result;
+
+    auto position = [&](unsigned int v) {
+      return glm::dvec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+    };
+
+    // Weld vertices with identical positions into groups, the first vertex identifies the group
+    std::vector<unsigned int> group(vertexCount);
+    std::vector<std::vector<unsigned int>> members(vertexCount);
+    std::map<std::array<float, 3>, unsigned int> unique;
+    for (unsigned int v = 0; v < vertexCount; v++) {
+      std::array<float, 3> key{{positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]}};
+      group[v] = unique.emplace(key, v).first->second;
+      members[group[v]].push_back(v);
+    }
+
+    // Area weighted plane quadrics of all triangles touching the group
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<unsigned long long, unsigned int> edgeUse;
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+      auto p0 = position(result[i]), p1 = position(result[i + 1]), p2 = position(result[i + 2]);
+      auto n = glm::cross(p1 - p0, p2 - p0);
+      auto area = glm::length(n);
+      for (int k = 0; k < 3; k++)
+        edgeUse[edgeKey(group[result[i + k]], group[result[i + (k + 1) % 3]])]++;
+      if (area <= 0.0) continue;
+      n /= area;
+      for (int k = 0; k < 3; k++)
+        quadrics[group[result[i + k]]].addPlane(n, -glm::dot(n, p0), area);
+    }
+
+    // Border edges add a plane perpendicular to their triangle so the outline is preserved
+    for (size_t i = 0; i + 2 < result.size(); i += 3) {
+      auto p0 = position(result[i]), p1 = position(result[i + 1]), p2 = position(result[i + 2]);
+      auto n = glm::cross(p1 - p0, p2 - p0);
+      if (glm::length(n) <= 0.0) continue;
+      for (int k = 0; k < 3; k++) {
+        auto a = group[result[i + k]], b = group[result[i + (k + 1) % 3]];
+        if (edgeUse[edgeKey(a, b)] != 1) continue;
+        auto edge = position(b) - position(a);
+        auto length = glm::length(edge);
+        if (length <= 0.0) continue;
+        auto borderNormal = glm::normalize(glm::cross(edge, n));
+        auto weight = length * length * BORDER_WEIGHT;
+        quadrics[a].addPlane(borderNormal, -glm::dot(borderNormal, position(a)), weight);
+        quadrics[b].addPlane(borderNormal, -glm::dot(borderNormal, position(a)), weight);
+      }
+    }
+
+    size_t targetTriangles = targetIndexCount / 3;
+    while (result.size() / 3 > targetTriangles) {
+      size_t triangles = result.size() / 3;
+
+      // Triangles touching each group and the number of triangles using each group edge
+      std::vector<std::vector<unsigned int>> groupTriangles(vertexCount);
+      edgeUse.clear();
+      for (unsigned int t = 0; t < triangles; t++) {
+        for (int k = 0; k < 3; k++) {
+          auto a = group[result[t * 3 + k]], b = group[result[t * 3 + (k + 1) % 3]];
+          groupTriangles[a].push_back(t);
+          edgeUse[edgeKey(a, b)]++;
+        }
+      }
+
+      // Groups on an open border may only slide along it, non-manifold groups are never moved
+      std::vector<char> border(vertexCount, 0), locked(vertexCount, 0);
+      for (auto &edge : edgeUse) {
+        auto a = static_cast<unsigned int>(edge.first >> 32), b = static_cast<unsigned int>(edge.first);
+        if (edge.second == 1) border[a] = border[b] = 1;
+        if (edge.second > 2) locked[a] = locked[b] = 1;
+      }
+
+      // Rank both directions of every edge by the quadric error at the target position
+      std::vector<Collapse> collapses;
+      collapses.reserve(edgeUse.size() * 2);
+      for (auto &edge : edgeUse) {
+        auto a = static_cast<unsigned int>(edge.first >> 32), b = static_cast<unsigned int>(edge.first);
+        if (edge.second > 2) continue;
+        for (auto from : {a, b}) {
+          auto to = from == a ? b : a;
+          if (locked[from] || (border[from] && edge.second != 1)) continue;
+          Quadric q = quadrics[from];
+          q.add(quadrics[to]);
+          collapses.push_back({from, to, q.error(position(to))});
+        }
+      }
+      std::sort(collapses.begin(), collapses.end(),
+                [](const Collapse &l, const Collapse &r) { return l.cost < r.cost; });
+
+      // Greedily collapse, each collapse freezes the neighbourhood of the moved group for this pass
+      std::vector<unsigned int> remap(vertexCount);
+      std::iota(remap.begin(), remap.end(), 0u);
+      std::vector<char> touched(vertexCount, 0);
+      std::vector<std::pair<unsigned int, unsigned int>> moves;
+      size_t removed = 0;
+
+      for (auto &collapse : collapses) {
+        if (triangles - removed <= targetTriangles) break;
+        if (touched[collapse.from] || touched[collapse.to]) continue;
+
+        // Move every vertex of the group onto a neighbour in the target group so seams stay closed,
+        // vertices without such a neighbour (faceted meshes) use the first vertex of the target group
+        moves.clear();
+        for (auto u : members[collapse.from]) {
+          bool referenced = false;
+          unsigned int partner = collapse.to;
+          bool found = false;
+          for (auto t : groupTriangles[collapse.from]) {
+            auto tri = &result[t * 3];
+            if (tri[0] != u && tri[1] != u && tri[2] != u) continue;
+            referenced = true;
+            for (int k = 0; k < 3 && !found; k++) {
+              if (group[tri[k]] == collapse.to) {
+                partner = tri[k];
+                found = true;
+              }
+            }
+            if (found) break;
+          }
+          if (referenced) moves.emplace_back(u, partner);
+        }
+
+        // Reject collapses that would flip or degenerate remaining triangles
+        auto target = position(collapse.to);
+        size_t collapsed = 0;
+        bool valid = true;
+        for (auto t : groupTriangles[collapse.from]) {
+          auto tri = &result[t * 3];
+          if (group[tri[0]] == collapse.to || group[tri[1]] == collapse.to || group[tri[2]] == collapse.to) {
+            collapsed++;
+            continue;
+          }
+          glm::dvec3 before[3], after[3];
+          for (int k = 0; k < 3; k++) {
+            before[k] = position(tri[k]);
+            after[k] = group[tri[k]] == collapse.from ? target : before[k];
+          }
+          auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+          auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+          if (glm::dot(n0, n1) <= 0.2 * glm::length(n0) * glm::length(n1)) {
+            valid = false;
+            break;
+          }
+        }
+        if (!valid) continue;
+
+        for (auto &move : moves) remap[move.first] = move.second;
+        quadrics[collapse.to].add(quadrics[collapse.from]);
+        for (auto t : groupTriangles[collapse.from])
+          for (int k = 0; k < 3; k++) touched[group[result[t * 3 + k]]] = 1;
+        removed += collapsed;
+      }
+
+      if (removed == 0) break;
+
+      // Apply the collapses and drop triangles that became degenerate
+      size_t write = 0;
+      for (size_t i = 0; i + 2 < result.size(); i += 3) {
+        auto a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+        if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c]) continue;
+        result[write++] = a;
+        result[write++] = b;
+        result[write++] = c;
+      }
+      result.resize(write);
+    }
+
+    return result;
+  }
+
+  std::vector<std::vector<unsigned int>> generateLods(const std::vector<unsigned int> &indices, const float *positions,
+                                                      size_t vertexCount, int levels, float ratio) {
+    std::vector<std::vector<unsigned int>> lods{indices};
+    for (int level = 1; level < levels; level++) {
+      auto &previous = lods.back();
+      auto target = static_cast<size_t>(previous.size() / 3 * ratio) * 3;
+      auto lod = simplify(previous, positions, vertexCount, target);
+
+      // Stop when the mesh can not be reduced any further
+      if (lod.empty() || lod.size() >= previous.size()) break;
+      lods.push_back(std::move(lod));
+    }
+    return lods;
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+namespace ppgso {
+
+  /*!
+   * Reduce the triangle count of an indexed triangle list using quadric error metrics.
+   *
+   * Every edge collapse snaps one vertex onto its neighbour, vertices are never moved or created
+   * so the simplified indices can reuse the original vertex buffers. Vertices sharing a position
+   * (texture or normal seams) are collapsed together and open borders only collapse along the border.
+   *
+   * @param indices - Triangle list indices to simplify.
+   * @param positions - Tightly packed xyz vertex positions referenced by indices.
+   * @param vertexCount - Number of vertices in positions.
+   * @param targetIndexCount - Desired number of indices, result is larger when the mesh can not be reduced further.
+   * @return - Simplified triangle list indices.
+   */
+  std::vector<unsigned int> simplify(const std::vector<unsigned int> &indices, const float *positions,
+                                     size_t vertexCount, size_t targetIndexCount);
+
+  /*!
+   * Reduce the triangle count of an indexed triangle list stored in a larger array, see simplify above.
+   *
+   * @param indices - First index of the triangle list to simplify.
+   * @param indexCount - Number of indices in the triangle list.
+   * @param positions - Tightly packed xyz vertex positions referenced by indices.
+   * @param vertexCount - Number of vertices in positions.
+   * @param targetIndexCount - Desired number of indices, result is larger when the mesh can not be reduced further.
+   * @return - Simplified triangle list indices.
+   */
+  std::vector<unsigned int> simplify(const unsigned int *indices, size_t indexCount, const float *positions,
+                                     size_t vertexCount, size_t targetIndexCount);
+
+  /*!
+   * Generate a level of detail chain, each level is simplified from the previous one.
+   *
+   * @param indices - Triangle list indices of the full detail mesh, returned as level 0.
+   * @param positions - Tightly packed xyz vertex positions referenced by indices.
+   * @param vertexCount - Number of vertices in positions.
+   * @param levels - Maximum number of levels including the full detail one.
+   * @param ratio - Fraction of triangles kept from one level to the next.
+   * @return - Indices of each level, stops early when the mesh can not be reduced further.
+   */
+  std::vector<std::vector<unsigned int>> generateLods(const std::vector<unsigned int> &indices, const float *positions,
+                                                      size_t vertexCount, int levels, float ratio);
+}
@@ -0,0 +1,133 @@
+#include "state.h"
+
+namespace ppgso {
+  namespace state {
+
+    // Texture units tracked, binds to higher units are always issued
+    const GLuint TRACKED_UNITS = 32;
+
+    // Marks state that is not known, forces the next change to be issued
+    const GLuint UNKNOWN = ~0u;
+    const int UNKNOWN_FLAG = -1;
+
+    struct texture_binding {
+      GLenum target;
+      GLuint texture;
+    };
+
+    // State last set through the cache
+    struct gl_state {
+      GLuint program;
+      GLuint vao;
+      GLuint activeUnit;
+      texture_binding textures[TRACKED_UNITS];
+      int blend, depthTest, depthMask;
+      GLenum blendSource, blendDestination;
+
+      gl_state() {
+        reset();
+      }
+
+      void reset() {
+        program = vao = activeUnit = UNKNOWN;
+        for (auto &binding : textures) binding = {UNKNOWN, UNKNOWN};
+        blend = depthTest = depthMask = UNKNOWN_FLAG;
+        blendSource = blendDestination = UNKNOWN;
+      }
+    };
+
+    static gl_state current;
+    static Counters counters;
+
+    static bool changed(bool same) {
+      if (same) {
+        counters.elided++;
+        return false;
+      }
+      counters.issued++;
+      return true;
+    }
+
+    void useProgram(GLuint program) {
+      if (!changed(current.program == program)) return;
+      glUseProgram(program);
+      current.program = program;
+    }
+
+    void bindVertexArray(GLuint vao) {
+      if (!changed(current.vao == vao)) return;
+      glBindVertexArray(vao);
+      current.vao = vao;
+    }
+
+    void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+      // The unit is activated even for elided binds so texture edits that follow apply to it
+      if (current.activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        current.activeUnit = unit;
+      }
+
+      if (unit < TRACKED_UNITS) {
+        auto &binding = current.textures[unit];
+        if (!changed(binding.target == target && binding.texture == texture)) return;
+        binding = {target, texture};
+      } else {
+        counters.issued++;
+      }
+      glBindTexture(target, texture);
+    }
+
+    static void setCapability(int &flag, GLenum capability, bool enabled) {
+      if (!changed(flag == (int) enabled)) return;
+      if (enabled) glEnable(capability);
+      else glDisable(capability);
+      flag = enabled;
+    }
+
+    void setBlend(bool enabled) {
+      setCapability(current.blend, GL_BLEND, enabled);
+    }
+
+    void setBlendFunc(GLenum source, GLenum destination) {
+      if (!changed(current.blendSource == source && current.blendDestination == destination)) return;
+      glBlendFunc(source, destination);
+      current.blendSource = source;
+      current.blendDestination = destination;
+    }
+
+    void setDepthTest(bool enabled) {
+      setCapability(current.depthTest, GL_DEPTH_TEST, enabled);
+    }
+
+    void setDepthMask(bool enabled) {
+      if (!changed(current.depthMask == (int) enabled)) return;
+      glDepthMask((GLboolean) enabled);
+      current.depthMask = enabled;
+    }
+
+    void releaseProgram(GLuint program) {
+      if (current.program == program) current.program = UNKNOWN;
+    }
+
+    void releaseVertexArray(GLuint vao) {
+      if (current.vao == vao) current.vao = UNKNOWN;
+    }
+
+    void releaseTexture(GLuint texture) {
+      for (auto &binding : current.textures)
+        if (binding.texture == texture) binding.texture = UNKNOWN;
+    }
+
+    void invalidate() {
+      current.reset();
+    }
+
+    Counters getCounters() {
+      return counters;
+    }
+
+    void resetCounters() {
+      counters = Counters{};
+    }
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <GL/glew.h>
+
+namespace ppgso {
+  namespace state {
+
+    /*!
+     * Number of state changes passed to OpenGL and skipped because the state was already set.
+     */
+    struct Counters {
+      unsigned int issued = 0;
+      unsigned int elided = 0;
+    };
+
+    /*!
+     * Use program unless it is already in use.
+     *
+     * @param program - OpenGL program identifier.
+     */
+    void useProgram(GLuint program);
+
+    /*!
+     * Bind vertex array object unless it is already bound.
+     *
+     * @param vao - OpenGL vertex array identifier.
+     */
+    void bindVertexArray(GLuint vao);
+
+    /*!
+     * Bind texture to a texture unit unless it is already bound there.
+     * The unit is left active in both cases, so the texture can be edited right after the call.
+     *
+     * @param unit - Texture unit number, 0 for GL_TEXTURE0.
+     * @param target - Texture target such as GL_TEXTURE_2D.
+     * @param texture - OpenGL texture identifier.
+     */
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    /*!
+     * Enable or disable blending.
+     *
+     * @param enabled - True to enable GL_BLEND.
+     */
+    void setBlend(bool enabled);
+
+    /*!
+     * Set blending factors.
+     *
+     * @param source - Source factor passed to glBlendFunc.
+     * @param destination - Destination factor passed to glBlendFunc.
+     */
+    void setBlendFunc(GLenum source, GLenum destination);
+
+    /*!
+     * Enable or disable depth testing.
+     *
+     * @param enabled - True to enable GL_DEPTH_TEST.
+     */
+    void setDepthTest(bool enabled);
+
+    /*!
+     * Enable or disable writing to the depth buffer.
+     *
+     * @param enabled - Value passed to glDepthMask.
+     */
+    void setDepthMask(bool enabled);
+
+    /*!
+     * Forget objects that are about to be deleted, OpenGL may reuse their identifiers.
+     *
+     * @param program - OpenGL program identifier.
+     */
+    void releaseProgram(GLuint program);
+    void releaseVertexArray(GLuint vao);
+    void releaseTexture(GLuint texture);
+
+    /*!
+     * Forget all cached state. Call after changing tracked state with raw OpenGL calls
+     * or after switching OpenGL contexts.
+     */
+    void invalidate();
+
+    /*!
+     * Get counters of issued and skipped state changes since the last reset.
+     *
+     * @return - Counters since the last call to resetCounters.
+     */
+    Counters getCounters();
+
+    /*!
+     * Reset the counters, usually once per frame.
+     */
+    void resetCounters();
+  }
+}
@@ -13,13 +13,14 @@ ppgso::Texture::Texture(Image&& image) : image{std::move(image)} {
 }
 
 ppgso::Texture::~Texture() {
+  state::releaseTexture(texture);
   glDeleteTextures(1, &texture);
 }
 
 void ppgso::Texture::initGL() {
   // Create new texture object
   glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  bind();
 
   // Reserve texture storage
   glTexStorage2D(GL_TEXTURE_2D, 3, GL_RGB8, image.width, image.height);
@@ -44,8 +45,7 @@ void ppgso::Texture::update() {
 }
 
 void ppgso::Texture::bind(int id) const {
-  glActiveTexture((GLenum) (GL_TEXTURE0 + id));
-  glBindTexture(GL_TEXTURE_2D, texture);
+  state::bindTexture((GLuint) id, GL_TEXTURE_2D, texture);
 }
 
 GLuint ppgso::Texture::getTexture() {
@@ -7,6 +7,7 @@
 #include <GL/glew.h>
 
 #include "image.h"
+#include "state.h"
 
 namespace ppgso {
 
@@ -43,7 +44,7 @@ namespace ppgso {
     GLuint getTexture();
 
     /*!
-     * Bind the OpenGL texture for use.
+     * Bind the OpenGL texture for use, skipped when it is already bound to the texture unit.
      *
      * @param id - OpenGL Texture id to bind to (0 default)
      */
@@ -0,0 +1,55 @@
+#include <unordered_map>
+
+#include "uniform_buffer.h"
+
+// Binding points and bound buffers of all uniform blocks by block name
+static std::unordered_map<std::string, GLuint> &bindingPoints() {
+  static std::unordered_map<std::string, GLuint> points;
+  return points;
+}
+
+static std::unordered_map<std::string, ppgso::UniformBuffer *> &boundBuffers() {
+  static std::unordered_map<std::string, ppgso::UniformBuffer *> buffers;
+  return buffers;
+}
+
+ppgso::UniformBuffer::UniformBuffer(const std::string &block, GLsizeiptr size) : block{block} {
+  binding = getBindingPoint(block);
+
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+  bind();
+}
+
+ppgso::UniformBuffer::~UniformBuffer() {
+  auto &bound = boundBuffers();
+  auto current = bound.find(block);
+  if (current != bound.end() && current->second == this) bound.erase(current);
+  glDeleteBuffers(1, &buffer);
+}
+
+void ppgso::UniformBuffer::bind() {
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+  boundBuffers()[block] = this;
+}
+
+void ppgso::UniformBuffer::update(const void *data, GLsizeiptr size, GLintptr offset) {
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+}
+
+GLuint ppgso::UniformBuffer::getBindingPoint(const std::string &block) {
+  auto &points = bindingPoints();
+  auto point = points.find(block);
+  if (point != points.end()) return point->second;
+  auto binding = (GLuint) points.size();
+  points[block] = binding;
+  return binding;
+}
+
+ppgso::UniformBuffer *ppgso::UniformBuffer::getBound(const std::string &block) {
+  auto &bound = boundBuffers();
+  auto current = bound.find(block);
+  return current == bound.end() ? nullptr : current->second;
+}
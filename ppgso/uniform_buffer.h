@@ -0,0 +1,80 @@
+#pragma once
+#include <string>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace ppgso {
+
+  /*!
+   * Layout of the std140 "Frame" uniform block declared by the bundled shaders.
+   * Holds per-frame data shared by all objects, vec3 members are padded to vec4.
+   */
+  struct FrameUniforms {
+    glm::mat4 projectionMatrix{1.0f};
+    glm::mat4 viewMatrix{1.0f};
+    glm::vec4 lightDirection{0.0f};
+  };
+
+  class UniformBuffer {
+  public:
+
+    /*!
+     * Create a buffer for the GLSL uniform block "block" and bind it for use.
+     * Every shader program declaring a block of the same name reads from the buffer bound last.
+     *
+     * @param block - Name of the uniform block in GLSL.
+     * @param size - Size of the block in bytes, data is expected in std140 layout.
+     */
+    UniformBuffer(const std::string &block, GLsizeiptr size);
+
+    ~UniformBuffer();
+
+    /*!
+     * Bind the buffer to the binding point of its block so shaders read from it.
+     */
+    void bind();
+
+    /*!
+     * Upload part of the block to the GPU.
+     *
+     * @param data - Data to upload.
+     * @param size - Size of the data in bytes.
+     * @param offset - Offset in the block in bytes.
+     */
+    void update(const void *data, GLsizeiptr size, GLintptr offset = 0);
+
+    /*!
+     * Upload a structure matching the std140 layout of the block.
+     *
+     * @param data - Structure to upload.
+     * @param offset - Offset in the block in bytes.
+     */
+    template<typename T>
+    void update(const T &data, GLintptr offset = 0) {
+      update(&data, sizeof(T), offset);
+    }
+
+    /*!
+     * Get the binding point shared by all uniform blocks of the name "block".
+     * Binding points are assigned on first use.
+     *
+     * @param block - Name of the uniform block in GLSL.
+     * @return - OpenGL uniform buffer binding point.
+     */
+    static GLuint getBindingPoint(const std::string &block);
+
+    /*!
+     * Get the buffer bound last for the uniform block "block".
+     *
+     * @param block - Name of the uniform block in GLSL.
+     * @return - Bound buffer or nullptr when none is bound.
+     */
+    static UniformBuffer *getBound(const std::string &block);
+
+  private:
+    std::string block;
+    GLuint buffer;
+    GLuint binding;
+  };
+}
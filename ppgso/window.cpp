@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -6,9 +9,28 @@
 #include <GLFW/glfw3.h>
 
 #include "window.h"
+#include "profiler.h"
+#include "image_bmp.h"
 
 bool ppgso::Window::pollEvents() {
-  onIdle();
+  // Headless frames see a fixed timestep through glfwGetTime
+  if (headless.frames > 0) glfwSetTime(headlessFrame * headless.timestep);
+  auto start = std::chrono::steady_clock::now();
+
+  {
+    profiler::Scope frame{"frame"};
+    onIdle();
+  }
+  profiler::endFrame();
+
+  if (headless.frames > 0) {
+    // Wait for the GPU so the frame time includes rendering
+    glFinish();
+    auto frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    glfwPollEvents();
+    return finishHeadlessFrame(frameTime) && !glfwWindowShouldClose(window);
+  }
+
   glfwSwapBuffers(window);
   glfwPollEvents();
   return !glfwWindowShouldClose(window);
@@ -30,6 +52,14 @@ ppgso::Window::Window(std::string title, int width, int height) : title{title},
   glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
 
+  // Headless mode can be requested by the environment for benchmarks and tests
+  if (auto frames = std::getenv("PPGSO_HEADLESS")) {
+    auto timestep = std::getenv("PPGSO_HEADLESS_TIMESTEP");
+    auto dump = std::getenv("PPGSO_HEADLESS_DUMP");
+    setHeadless(std::atoi(frames), timestep ? std::atof(timestep) : 1.0 / 60.0, dump ? dump : "");
+  }
+  glfwWindowHint(GLFW_VISIBLE, headless.frames > 0 ? GL_FALSE : GL_TRUE);
+
   window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
   if (!window)
     throw std::runtime_error("Failed to initialize GLFW Window!");
@@ -46,6 +76,8 @@ ppgso::Window::Window(std::string title, int width, int height) : title{title},
 
   windows.insert({window, this});
 
+  if (headless.frames > 0) initHeadless();
+
 #ifndef NDEBUG
   // Basic OpenGL information to print
   std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
@@ -56,6 +88,11 @@ ppgso::Window::Window(std::string title, int width, int height) : title{title},
 }
 
 ppgso::Window::~Window() {
+  if (headlessFramebuffer) {
+    glDeleteFramebuffers(1, &headlessFramebuffer);
+    glDeleteRenderbuffers(1, &headlessColor);
+    glDeleteRenderbuffers(1, &headlessDepth);
+  }
   windows.erase(window);
   glfwDestroyWindow(window);
 }
@@ -140,6 +177,77 @@ ppgso::Window::glfwInstance& ppgso::Window::glfwInstance::Init() {
 }
 
 void ppgso::Window::fpsLimit(bool limit) {
-  if(limit) glfwSwapInterval(1);
-  glfwSwapInterval(0);
+  glfwSwapInterval(limit ? 1 : 0);
+}
+
+ppgso::Window::headless_settings ppgso::Window::headless;
+
+void ppgso::Window::setHeadless(int frames, double timestep, const std::string &dumpPrefix) {
+  headless.frames = frames;
+  headless.timestep = timestep;
+  headless.dumpPrefix = dumpPrefix;
+}
+
+void ppgso::Window::initHeadless() {
+  // Hidden windows have no pixels of their own, render into renderbuffers of the same size
+  int fbWidth, fbHeight;
+  glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+
+  glGenRenderbuffers(1, &headlessColor);
+  glBindRenderbuffer(GL_RENDERBUFFER, headlessColor);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fbWidth, fbHeight);
+
+  glGenRenderbuffers(1, &headlessDepth);
+  glBindRenderbuffer(GL_RENDERBUFFER, headlessDepth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, fbWidth, fbHeight);
+
+  glGenFramebuffers(1, &headlessFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, headlessFramebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headlessColor);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headlessDepth);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    throw std::runtime_error("Failed to create headless framebuffer!");
+
+  glViewport(0, 0, fbWidth, fbHeight);
+  frameTimes.reserve((size_t) headless.frames);
+}
+
+bool ppgso::Window::finishHeadlessFrame(double frameTime) {
+  frameTimes.push_back(frameTime);
+
+  if (!headless.dumpPrefix.empty()) {
+    int fbWidth, fbHeight;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+
+    // OpenGL rows start at the bottom, image rows at the top
+    Image image{fbWidth, fbHeight};
+    auto &framebuffer = image.getFramebuffer();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, headlessFramebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, fbWidth, fbHeight, GL_RGB, GL_UNSIGNED_BYTE, framebuffer.data());
+    for (int y = 0; y < fbHeight / 2; y++)
+      std::swap_ranges(framebuffer.begin() + y * fbWidth, framebuffer.begin() + (y + 1) * fbWidth,
+                       framebuffer.begin() + (fbHeight - 1 - y) * fbWidth);
+
+    std::stringstream file;
+    file << headless.dumpPrefix << std::setw(4) << std::setfill('0') << headlessFrame << ".bmp";
+    image::saveBMP(image, file.str());
+  }
+
+  headlessFrame++;
+  if (headlessFrame < headless.frames) return true;
+
+  // Frame time statistics of the whole run
+  auto sorted = frameTimes;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  for (auto time : sorted) total += time;
+  std::cout << title << ": " << sorted.size() << " frames"
+            << std::fixed << std::setprecision(3)
+            << ", avg " << total / sorted.size() << " ms"
+            << ", min " << sorted.front() << " ms"
+            << ", median " << sorted[sorted.size() / 2] << " ms"
+            << ", p95 " << sorted[sorted.size() * 95 / 100] << " ms"
+            << ", max " << sorted.back() << " ms" << std::endl;
+  return false;
 }
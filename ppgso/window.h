@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <map>
+#include <vector>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -37,6 +38,28 @@ namespace ppgso {
     static void glfw_mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
     static void glfw_window_refresh_callback(GLFWwindow *window);
 
+    // Headless mode renders a fixed number of frames into an offscreen framebuffer of a hidden window
+    struct headless_settings {
+      int frames = 0;
+      double timestep = 1.0 / 60.0;
+      std::string dumpPrefix;
+    };
+    static headless_settings headless;
+    GLuint headlessFramebuffer = 0, headlessColor = 0, headlessDepth = 0;
+    int headlessFrame = 0;
+    std::vector<double> frameTimes;
+
+    /*!
+     * Create the offscreen framebuffer used instead of the window in headless mode.
+     */
+    void initHeadless();
+
+    /*!
+     * Record frame time and dump the frame in headless mode.
+     * @return Will be true while there are frames left to render
+     */
+    bool finishHeadlessFrame(double frameTime);
+
   protected:
     GLFWwindow *window;
   public:
@@ -116,10 +139,27 @@ namespace ppgso {
 
     /*!
      * This function processes events in the event queue. Processing events will cause the window virtual functions associated with those events to be called.
+     * onIdle is timed as the "frame" section of the profiler, the profiler report is produced before swapping buffers.
      * @return Will be true if the Window is about to be closed
      */
     bool pollEvents();
 
+    /*!
+     * Render windows created after this call headless: the window is hidden, frames are rendered into
+     * an offscreen framebuffer and pollEvents returns false after the requested number of frames.
+     * Time reported by glfwGetTime advances by a fixed timestep each frame, frame time statistics
+     * are printed when the last frame is rendered.
+     *
+     * The same can be requested without code changes by the environment variables PPGSO_HEADLESS (frames),
+     * PPGSO_HEADLESS_TIMESTEP (seconds) and PPGSO_HEADLESS_DUMP (file prefix).
+     * Without a GPU run under Xvfb with Mesa, e.g. "LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./gl9_scene".
+     *
+     * @param frames - Number of frames to render, 0 to create regular windows
+     * @param timestep - Time between frames in seconds
+     * @param dumpPrefix - Prefix of BMP files every frame is saved to, empty to not save frames
+     */
+    static void setHeadless(int frames, double timestep = 1.0 / 60.0, const std::string &dumpPrefix = "");
+
     /*!
      * Limit FPS to vsync which is usually 60 FPS
      * @param limit - When true GLFW window refresh rate will use vsync
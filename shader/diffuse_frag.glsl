@@ -2,8 +2,12 @@
 // A texture is expected as program attribute
 uniform sampler2D Texture;
 
-// Direction of light
-uniform vec3 LightDirection;
+// Per-frame camera and light, shared by all programs through a uniform buffer
+layout(std140) uniform Frame {
+  mat4 ProjectionMatrix;
+  mat4 ViewMatrix;
+  vec3 LightDirection;
+};
 
 // (optional) Transparency
 uniform float Transparency;
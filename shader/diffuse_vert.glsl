@@ -4,9 +4,14 @@ layout(location = 0) in vec3 Position;
 layout(location = 1) in vec2 TexCoord;
 layout(location = 2) in vec3 Normal;
 
-// Matrices as program attributes
-uniform mat4 ProjectionMatrix;
-uniform mat4 ViewMatrix;
+// Per-frame camera and light, shared by all programs through a uniform buffer
+layout(std140) uniform Frame {
+  mat4 ProjectionMatrix;
+  mat4 ViewMatrix;
+  vec3 LightDirection;
+};
+
+// Model matrix as program attribute
 uniform mat4 ModelMatrix;
 
 // This will be passed to the fragment shader
@@ -1,4 +1,5 @@
 #version 330 core
+// @features FOAM FRESNEL
 
 in vec3 fragPosition;
 in vec3 fragNormal;
@@ -12,6 +13,7 @@ uniform float time;
 
 out vec4 fragColor;
 
+#ifdef FOAM
 // Simple hash function for noise
 float hash(vec2 p) {
     return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
@@ -34,6 +36,7 @@ float foam(vec2 uv, float waveHeight) {
 
     return foamPattern * crestFactor;
 }
+#endif
 
 void main() {
     // Light direction (sun)
@@ -54,13 +57,17 @@ void main() {
     // Add specular highlights
     color += vec3(0.8, 0.9, 1.0) * spec * 0.5;
 
+#ifdef FOAM
     // Add foam on wave crests
     float foamAmount = foam(fragTexCoord, fragWaveHeight);
     color = mix(color, foamColor, foamAmount);
+#endif
 
+#ifdef FRESNEL
     // Fresnel effect (more reflective at grazing angles)
     float fresnel = pow(1.0 - max(dot(viewDir, fragNormal), 0.0), 3.0);
     color = mix(color, vec3(0.7, 0.8, 0.9), fresnel * 0.3);
+#endif
 
     // Depth-based color variation
     float depthFactor = smoothstep(-5.0, 0.0, fragPosition.y);
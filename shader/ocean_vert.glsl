@@ -4,9 +4,14 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 texCoord;
 
+// Per-frame camera and light, shared by all programs through a uniform buffer
+layout(std140) uniform Frame {
+    mat4 ProjectionMatrix;
+    mat4 ViewMatrix;
+    vec3 LightDirection;
+};
+
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
 
 out vec3 fragPosition;
 out vec3 fragNormal;
@@ -25,5 +30,5 @@ void main() {
     fragTexCoord = texCoord;
     fragWaveHeight = position.y;
 
-    gl_Position = projectionMatrix * viewMatrix * worldPos;
+    gl_Position = ProjectionMatrix * ViewMatrix * worldPos;
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#version 330 core
+
+// GPU port of Terrain::finalHeight, one fragment per grid vertex
+
+// Permutation table for Perlin noise, 512 entries
+uniform isampler2D permutation;
+// Voronoi cell centers in world units sorted by bucket, see Terrain::initVoronoiCells
+uniform sampler2D voronoiCells;
+uniform isampler2D voronoiBucketStart;
+uniform vec2 voronoiOrigin;
+uniform ivec2 voronoiBuckets;
+uniform float voronoiBucketSize;
+
+uniform int resolution;
+uniform float size;
+uniform float maxHeight;
+uniform float noiseFrequency;
+// Index of TerrainType
+uniform int terrainType;
+
+layout(location = 0) out vec3 outPosition;
+
+int perm(int i) {
+    return texelFetch(permutation, ivec2(i, 0), 0).r;
+}
+
+float fade(float t) {
+    return t * t * t * (t * (t * 6 - 15) + 10);
+}
+
+float lerp(float t, float a, float b) {
+    return a + t * (b - a);
+}
+
+float grad(int hash, float x, float y) {
+    int h = hash & 7;
+    float u = h < 4 ? x : y;
+    float v = h < 4 ? y : x;
+    return ((h & 1) != 0 ? -u : u) + ((h & 2) != 0 ? -v : v);
+}
+
+float perlin(float x, float y) {
+    int X = int(floor(x)) & 255;
+    int Y = int(floor(y)) & 255;
+
+    x -= floor(x);
+    y -= floor(y);
+
+    float u = fade(x);
+    float v = fade(y);
+
+    int A  = perm(X) + Y;
+    int AA = perm(A);
+    int AB = perm(A + 1);
+    int B  = perm(X + 1) + Y;
+    int BA = perm(B);
+    int BB = perm(B + 1);
+
+    return lerp(v,
+        lerp(u, grad(perm(AA), x, y),
+                grad(perm(BA), x - 1, y)),
+        lerp(u, grad(perm(AB), x, y - 1),
+                grad(perm(BB), x - 1, y - 1))
+    );
+}
+
+float fbm(float x, float y, int octaves) {
+    float value = 0.0;
+    float amplitude = 0.5;
+    float frequency = noiseFrequency;
+
+    for (int i = 0; i < octaves; i++) {
+        value += amplitude * perlin(x * frequency, y * frequency);
+        frequency *= 2.0;
+        amplitude *= 0.5;
+    }
+
+    return value;
+}
+
+float ridged(float x, float y) {
+    float h = fbm(x, y, 6);
+    h = 1.0 - abs(h);
+    return h * h;
+}
+
+float voronoi(float x, float y) {
+    vec2 p = vec2(x, y);
+    float maxDist = size * 0.1;
+
+    // Cells farther than maxDist all give zero
+    vec2 hi = voronoiOrigin + vec2(voronoiBuckets) * voronoiBucketSize;
+    vec2 outside = max(max(voronoiOrigin - p, p - hi), vec2(0.0));
+    if (dot(outside, outside) >= maxDist * maxDist) return 0.0;
+
+    // Rings of buckets around the sample until the unvisited ones are farther than the closest cell
+    ivec2 center = ivec2(floor((p - voronoiOrigin) / voronoiBucketSize));
+    float minDist2 = 1e18;
+    for (int ring = 0;; ring++) {
+        for (int j = center.y - ring; j <= center.y + ring; j++) {
+            if (j < 0 || j >= voronoiBuckets.y) continue;
+            int stride = (j == center.y - ring || j == center.y + ring) ? 1 : 2 * ring;
+            for (int i = center.x - ring; i <= center.x + ring; i += stride) {
+                if (i < 0 || i >= voronoiBuckets.x) continue;
+
+                int b = j * voronoiBuckets.x + i;
+                int end = texelFetch(voronoiBucketStart, ivec2(b + 1, 0), 0).r;
+                for (int c = texelFetch(voronoiBucketStart, ivec2(b, 0), 0).r; c < end; c++) {
+                    vec2 d = p - texelFetch(voronoiCells, ivec2(c, 0), 0).xy;
+                    minDist2 = min(minDist2, dot(d, d));
+                }
+            }
+        }
+
+        float reach = float(ring) * voronoiBucketSize;
+        if (reach * reach >= min(minDist2, maxDist * maxDist)) break;
+    }
+
+    return 1.0 - clamp(sqrt(minDist2) / maxDist, 0.0, 1.0);
+}
+
+float canyon(float x, float y) {
+    float base = fbm(x * 0.02, y * 0.02, 4);
+    float detail = fbm(x * 0.1, y * 0.1, 3);
+
+    float channel = sin(x * 0.05 + detail * 2.0) * 0.5 + 0.5;
+    channel = pow(channel, 3.0);
+
+    return base * channel + detail * 0.2;
+}
+
+float plateaus(float x, float y) {
+    float h = fbm(x * 0.03, y * 0.03, 5);
+
+    const int steps = 5;
+    h = floor(h * steps) / steps;
+
+    h += fbm(x * 0.2, y * 0.2, 2) * 0.1;
+
+    return h;
+}
+
+// atan is undefined for the island center, atan2 of the CPU version returns 0 there
+float angleOf(float y, float x) {
+    return x == 0.0 && y == 0.0 ? 0.0 : atan(y, x);
+}
+
+float islandMask(float x, float y) {
+    float nx = x / size;
+    float ny = y / size;
+    float distFromCenter = sqrt(nx * nx + ny * ny);
+    float angle = angleOf(ny, nx);
+
+    float shapeNoise = perlin(angle * 2.0, 0.0) * 0.15;
+    shapeNoise += perlin(angle * 5.0, 100.0) * 0.08;
+
+    float mask = clamp(1.0 - (distFromCenter - shapeNoise), 0.0, 1.0);
+    return pow(mask, 1.8);
+}
+
+float coastlineVariation(float x, float y) {
+    float angle = angleOf(y / size, x / size);
+
+    float coastal = perlin(angle * 3.0 + 50.0, 0.0) * 0.5 + 0.5;
+    coastal += perlin(angle * 7.0 + 150.0, 100.0) * 0.25;
+
+    return clamp(coastal, 0.0, 1.0);
+}
+
+float baseNoise(float x, float y) {
+    float noise = 0.0;
+    if (terrainType == 0) noise = fbm(x * 0.04, y * 0.04, 6);
+    else if (terrainType == 1) noise = ridged(x * 0.03, y * 0.03);
+    else if (terrainType == 2) noise = voronoi(x, y);
+    else if (terrainType == 3) noise = canyon(x, y);
+    else noise = plateaus(x, y);
+
+    return clamp((noise + 1.0) * 0.5, 0.0, 1.0);
+}
+
+float finalHeight(float x, float y) {
+    float islandShape = islandMask(x, y);
+    float base = baseNoise(x, y);
+    float coastType = coastlineVariation(x, y);
+
+    float oceanFloor = -15.0;
+    float elevation;
+
+    if (islandShape < 0.05) {
+        // Deep ocean
+        elevation = oceanFloor;
+    } else if (islandShape < 0.25) {
+        // Underwater slope
+        float t = (islandShape - 0.05) / 0.20;
+        elevation = mix(oceanFloor, -3.0, pow(t, 1.5));
+    } else if (islandShape < 0.40) {
+        // Coastline transition (beaches and cliffs)
+        float t = (islandShape - 0.25) / 0.15;
+
+        if (coastType > 0.55) {
+            elevation = mix(-3.0, 1.0, pow(t, 0.6));
+
+            // Sand ripples
+            float ripple = sin(x * 4.0) * cos(y * 4.0) * 0.12;
+            if (elevation > -1.0 && elevation < 2.0)
+                elevation += ripple * (1.0 - abs(elevation) * 0.5);
+        } else {
+            elevation = mix(-3.0, 5.0, pow(t, 3.0));
+            elevation += fbm(x * 0.25, y * 0.25, 3) * 1.2;
+        }
+    } else {
+        // Inland terrain
+        float t = (islandShape - 0.40) / 0.60;
+        float terrainHeight = maxHeight * t * base;
+
+        float coastalHeight = coastType > 0.55 ? 1.0 : 5.0;
+        elevation = mix(coastalHeight, terrainHeight, pow(t, 0.7));
+
+        elevation += fbm(x * 0.12, y * 0.12, 3) * 2.5 * t;
+
+        // Central peak/crater
+        if (islandShape > 0.85) {
+            float centerMod = (islandShape - 0.85) / 0.15;
+            elevation += base > 0.5 ? centerMod * 8.0 : -centerMod * 4.0;
+        }
+    }
+
+    return elevation;
+}
+
+void main() {
+    ivec2 vertex = ivec2(gl_FragCoord.xy);
+    float wx = (float(vertex.x) / resolution - 0.5) * size;
+    float wz = (float(vertex.y) / resolution - 0.5) * size;
+    outPosition = vec3(wx, finalHeight(wx, wz), wz);
+}
@@ -0,0 +1,34 @@
+#version 330 core
+
+// Compact terrain vertices, only the height and a packed normal are stored per vertex.
+// The grid position and UV follow from the vertex index, which includes the base vertex of the drawn chunk.
+layout(location = 0) in float inHeight;
+layout(location = 1) in vec4 inNormal;
+
+// Per-frame camera and light, shared by all programs through a uniform buffer
+layout(std140) uniform Frame {
+    mat4 ProjectionMatrix;
+    mat4 ViewMatrix;
+    vec3 LightDirection;
+};
+
+uniform mat4 modelMatrix;
+uniform int resolution;
+uniform float size;
+
+out vec3 vNormal;
+out vec3 vWorldPos;
+out vec2 vUV;
+
+void main() {
+    int vertices = resolution + 1;
+    vec2 uv = vec2(gl_VertexID % vertices, gl_VertexID / vertices) / float(resolution);
+    vec3 position = vec3((uv.x - 0.5) * size, inHeight, (uv.y - 0.5) * size);
+
+    vec4 world = modelMatrix * vec4(position, 1.0);
+    vWorldPos = world.xyz;
+    // Normals are stored unsigned normalized
+    vNormal = mat3(transpose(inverse(modelMatrix))) * (inNormal.xyz * 2.0 - 1.0);
+    vUV = uv;
+    gl_Position = ProjectionMatrix * ViewMatrix * world;
+}
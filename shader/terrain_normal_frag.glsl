@@ -0,0 +1,52 @@
+#version 330 core
+
+// Vertex normals of the generated grid, same area weighted face normal sum as Terrain::computeNormals
+// or the central differences of Terrain::generateHeights. Written unsigned normalized to be read back packed.
+
+// Positions written by the height pass
+uniform sampler2D positions;
+uniform int resolution;
+uniform bool finiteDifference;
+
+layout(location = 0) out vec4 outNormal;
+
+vec3 position(ivec2 vertex) {
+    return texelFetch(positions, vertex, 0).xyz;
+}
+
+void main() {
+    ivec2 vertex = ivec2(gl_FragCoord.xy);
+
+    if (finiteDifference) {
+        ivec2 lo = max(vertex - 1, ivec2(0));
+        ivec2 hi = min(vertex + 1, ivec2(resolution));
+        vec3 dx = position(ivec2(hi.x, vertex.y)) - position(ivec2(lo.x, vertex.y));
+        vec3 dz = position(ivec2(vertex.x, hi.y)) - position(ivec2(vertex.x, lo.y));
+        outNormal = vec4(normalize(vec3(-dx.y / dx.x, 1.0, -dz.y / dz.z)) * 0.5 + 0.5, 0.0);
+        return;
+    }
+
+    vec3 normal = vec3(0.0);
+
+    // Each quad is split into triangles (i0, i2, i1) and (i1, i2, i3), visit the four quads sharing the vertex
+    for (int dz = -1; dz <= 0; dz++) {
+        for (int dx = -1; dx <= 0; dx++) {
+            ivec2 quad = vertex + ivec2(dx, dz);
+            if (quad.x < 0 || quad.y < 0 || quad.x >= resolution || quad.y >= resolution) continue;
+
+            vec3 p0 = position(quad);
+            vec3 p1 = position(quad + ivec2(1, 0));
+            vec3 p2 = position(quad + ivec2(0, 1));
+            vec3 p3 = position(quad + ivec2(1, 1));
+
+            // Vertex is i0 of the quad at (0, 0), i1 at (-1, 0), i2 at (0, -1) and i3 at (-1, -1)
+            bool isI0 = dx == 0 && dz == 0;
+            bool isI3 = dx == -1 && dz == -1;
+            if (!isI3) normal += cross(p2 - p0, p1 - p0);
+            if (!isI0) normal += cross(p2 - p1, p3 - p1);
+        }
+    }
+
+    float len = length(normal);
+    outNormal = vec4((len > 0.0001 ? normal / len : vec3(0.0, 1.0, 0.0)) * 0.5 + 0.5, 0.0);
+}
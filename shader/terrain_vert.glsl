@@ -4,9 +4,14 @@ layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inUV;
 
+// Per-frame camera and light, shared by all programs through a uniform buffer
+layout(std140) uniform Frame {
+    mat4 ProjectionMatrix;
+    mat4 ViewMatrix;
+    vec3 LightDirection;
+};
+
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
 
 out vec3 vNormal;
 out vec3 vWorldPos;
@@ -17,5 +22,5 @@ void main() {
     vWorldPos = world.xyz;
     vNormal = mat3(transpose(inverse(modelMatrix))) * inNormal;
     vUV = inUV;
-    gl_Position = projectionMatrix * viewMatrix * world;
+    gl_Position = ProjectionMatrix * ViewMatrix * world;
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include <iostream>
+#include <cstdlib>
 #include <ppgso/ppgso.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "../terrain/Terrain.h"
+#include "../terrain/TerrainStream.h"
 #include "../ocean/Ocean.h"
 
 const unsigned int SIZE = 1024;
@@ -11,8 +13,13 @@ const unsigned int SIZE = 1024;
 class OceanScene {
 private:
     std::unique_ptr<Terrain> terrain;
+    // Unbounded tiles of the same noise, replaces the fixed terrain while enabled
+    std::unique_ptr<TerrainStream> stream;
     std::unique_ptr<Ocean> ocean;
 
+    // Per-frame camera data shared by the terrain and ocean shaders
+    std::unique_ptr<ppgso::UniformBuffer> frame;
+
     // Camera modes
     enum CameraMode { ORBIT, FREE };
     CameraMode cameraMode = ORBIT;
@@ -46,11 +53,17 @@ private:
     glm::mat4 projection;
     glm::mat4 view;
 
+    // Camera eye and target after the last two simulation steps, rendering interpolates between them
+    glm::vec3 previousEye, previousCenter;
+    glm::vec3 eye, center;
+
     // Track key states for smooth movement
     bool keys[GLFW_KEY_LAST] = {false};
 
 public:
     OceanScene() {
+        frame = std::make_unique<ppgso::UniformBuffer>("Frame", sizeof(ppgso::FrameUniforms));
+
         // Initialize terrain (island)
         terrain = std::make_unique<Terrain>(
             512,                      // resolution
@@ -59,6 +72,14 @@ public:
             TerrainType::ISLAND       // type
         );
 
+        // Erosion takes seconds, show its progress in steps of 10 percent
+        terrain->setErosionProgress([printed = -1](float progress) mutable {
+            int percent = (int) (progress * 10) * 10;
+            if (percent == printed) return;
+            printed = percent;
+            std::cout << "\rErosion " << percent << "%" << (percent == 100 ? "\n" : "") << std::flush;
+        });
+
         // Initialize ocean (larger than island)
         ocean = std::make_unique<Ocean>(
             1024.0f,          // size
@@ -82,6 +103,8 @@ public:
         updateFreeCameraVectors();
 
         updateCamera();
+        previousEye = eye;
+        previousCenter = center;
 
         // Setup projection with extended far plane
         projection = glm::perspective(
@@ -116,11 +139,15 @@ public:
             cos(angleRad) * cos(pitchRad) * cameraDistance
         );
 
-        view = glm::lookAt(cameraPosition, orbitTarget, glm::vec3(0.0f, 1.0f, 0.0f));
+        eye = cameraPosition;
+        center = orbitTarget;
+        view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
     }
 
     void updateFreeCamera() {
-        view = glm::lookAt(cameraPosition, cameraPosition + cameraFront, cameraUp);
+        eye = cameraPosition;
+        center = cameraPosition + cameraFront;
+        view = glm::lookAt(eye, center, cameraUp);
     }
 
     void updateCamera() {
@@ -131,7 +158,15 @@ public:
         }
     }
 
+    void printTerrainGeneration() {
+        std::cout << "Terrain regenerated on " << (terrain->getLastGenerationOnGpu() ? "GPU" : "CPU")
+                  << " in " << terrain->getLastGenerationTime() << " ms\n";
+    }
+
     void update(float dt) {
+        previousEye = eye;
+        previousCenter = center;
+
         if (cameraMode == ORBIT) {
             // Orbit mode controls
             if (keys[GLFW_KEY_A]) {
@@ -226,24 +261,45 @@ public:
         }
 
         updateCamera();
+    }
 
-        // Update ocean waves
+    void animate(float dt) {
+        // Update ocean waves once per frame, the meshes are uploaded to GPU on every update
         ocean->update(dt);
         terrain->update(dt);
     }
 
-    void render() {
+    void render(float alpha) {
         // Clear screen with sky color
         glClearColor(0.5f, 0.7f, 0.9f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glEnable(GL_DEPTH_TEST);
+        ppgso::state::setDepthTest(true);
+
+        // Upload camera matrices once for all objects
+        ppgso::FrameUniforms uniforms;
+        uniforms.projectionMatrix = projection;
+        auto up = cameraMode == ORBIT ? glm::vec3(0.0f, 1.0f, 0.0f) : cameraUp;
+        auto renderEye = glm::mix(previousEye, eye, alpha);
+        uniforms.viewMatrix = glm::lookAt(renderEye, glm::mix(previousCenter, center, alpha), up);
+        frame->update(uniforms);
 
         // Render terrain first (opaque)
-        terrain->render(view, projection);
+        {
+            ppgso::profiler::Scope profile{"terrain"};
+            if (stream) {
+                stream->update(renderEye);
+                stream->render(projection * uniforms.viewMatrix);
+            } else {
+                terrain->render(renderEye, projection * uniforms.viewMatrix);
+            }
+        }
 
         // Render ocean last (transparent)
-        ocean->render(view, projection);
+        {
+            ppgso::profiler::Scope profile{"ocean"};
+            ocean->render();
+        }
     }
 
     void handleKeyboard(int key, int action) {
@@ -258,24 +314,59 @@ public:
         if (action == GLFW_PRESS) {
             switch (key) {
                 case GLFW_KEY_1:
+                    if (stream) stream->reset();
                     terrain->setType(TerrainType::ISLAND);
                     std::cout << "Terrain: ISLAND\n";
+                    printTerrainGeneration();
                     break;
                 case GLFW_KEY_2:
+                    if (stream) stream->reset();
                     terrain->setType(TerrainType::RIDGED);
                     std::cout << "Terrain: RIDGED\n";
+                    printTerrainGeneration();
                     break;
                 case GLFW_KEY_3:
+                    if (stream) stream->reset();
                     terrain->setType(TerrainType::VORONOI);
                     std::cout << "Terrain: VORONOI\n";
+                    printTerrainGeneration();
                     break;
                 case GLFW_KEY_4:
+                    if (stream) stream->reset();
                     terrain->setType(TerrainType::CANYON);
                     std::cout << "Terrain: CANYON\n";
+                    printTerrainGeneration();
                     break;
                 case GLFW_KEY_5:
+                    if (stream) stream->reset();
                     terrain->setType(TerrainType::PLATEAUS);
                     std::cout << "Terrain: PLATEAUS\n";
+                    printTerrainGeneration();
+                    break;
+                case GLFW_KEY_G:
+                    terrain->setGpuGeneration(!terrain->getGpuGeneration());
+                    std::cout << "Terrain generation: " << (terrain->getGpuGeneration() ? "GPU" : "CPU") << "\n";
+                    printTerrainGeneration();
+                    break;
+                case GLFW_KEY_N:
+                    terrain->setFiniteDifferenceNormals(!terrain->getFiniteDifferenceNormals());
+                    std::cout << "Terrain normals: " << (terrain->getFiniteDifferenceNormals() ? "finite differences" : "face average") << "\n";
+                    printTerrainGeneration();
+                    break;
+                case GLFW_KEY_O:
+                    if (stream) stream->reset();
+                    // About one droplet for every two grid vertices
+                    terrain->setErosion(terrain->getErosionDroplets() ? 0 : 512 * 512 / 2);
+                    std::cout << "Terrain erosion: " << (terrain->getErosionDroplets() ? "ON" : "OFF") << "\n";
+                    printTerrainGeneration();
+                    break;
+                case GLFW_KEY_I:
+                    if (stream) {
+                        stream.reset();
+                    } else {
+                        stream = std::make_unique<TerrainStream>(*terrain);
+                    }
+                    std::cout << "Infinite terrain: " << (stream ? "ON" : "OFF") << "\n";
                     break;
                 case GLFW_KEY_TAB:
                     // Toggle camera mode
@@ -326,6 +417,18 @@ public:
                     ocean->setWaveSpeed(1.5f);
                     std::cout << "Wave speed increased\n";
                     break;
+                case GLFW_KEY_T:
+                    ppgso::profiler::setEnabled(!ppgso::profiler::isEnabled());
+                    std::cout << "Frame profiler: " << (ppgso::profiler::isEnabled() ? "ON" : "OFF") << "\n";
+                    break;
+                case GLFW_KEY_H:
+                    ppgso::Shader::setHotReload(!ppgso::Shader::getHotReload());
+                    std::cout << "Shader hot reload: " << (ppgso::Shader::getHotReload() ? "ON" : "OFF") << "\n";
+                    break;
+                case GLFW_KEY_V:
+                    ocean->setFoam(!ocean->getFoam());
+                    std::cout << "Foam: " << (ocean->getFoam() ? "ON" : "OFF") << "\n";
+                    break;
                 case GLFW_KEY_C:
                     // Print camera info
                     if (cameraMode == ORBIT) {
@@ -400,31 +503,62 @@ int main() {
     std::cout << "  CTRL:       Move down\n";
     std::cout << "  Arrow Keys: Look around\n\n";
     std::cout << "TERRAIN:\n";
-    std::cout << "  1-5:        Change terrain type\n\n";
+    std::cout << "  1-5:        Change terrain type\n";
+    std::cout << "  G:          Toggle GPU terrain generation\n";
+    std::cout << "  N:          Toggle finite difference / face averaged normals\n";
+    std::cout << "  O:          Toggle hydraulic and thermal erosion\n";
+    std::cout << "  I:          Toggle infinite streamed terrain\n\n";
     std::cout << "OCEAN:\n";
     std::cout << "  Z:          Increase wave height\n";
-    std::cout << "  X:          Increase wave speed\n\n";
+    std::cout << "  X:          Increase wave speed\n";
+    std::cout << "  V:          Toggle foam\n\n";
     std::cout << "OTHER:\n";
+    std::cout << "  H:          Toggle shader hot reload from the source tree\n";
+    std::cout << "  T:          Toggle frame profiler report\n";
     std::cout << "  ESC:        Exit\n";
     std::cout << "==============================================\n\n";
 
-    // Main loop
-    auto lastTime = static_cast<float>(glfwGetTime());
+    // Record every frame to a CSV file for offline analysis when requested
+    if (auto csv = std::getenv("PPGSO_PROFILE_CSV")) {
+        ppgso::profiler::setCsvFile(csv);
+        ppgso::profiler::setEnabled(true);
+    }
+
+    // Camera moves in fixed steps, optionally limit the frame rate for pacing tests
+    ppgso::FixedTimestep timestep;
+    if (auto cap = std::getenv("PPGSO_FRAME_CAP")) {
+        glfwSwapInterval(0);
+        timestep.setFrameCap(std::atof(cap));
+    }
 
+    // Main loop
     while (!glfwWindowShouldClose(window)) {
-        // Calculate delta time
-        auto currentTime = static_cast<float>(glfwGetTime());
-        float dt = currentTime - lastTime;
-        lastTime = currentTime;
+        // Pick up edited shader sources when hot reload is enabled
+        ppgso::Shader::reloadChanged();
+
+        ppgso::profiler::begin("frame");
 
         // Update scene
-        scene.update(dt);
+        ppgso::profiler::begin("update");
+        float simulated = 0.0f;
+        float alpha = timestep.advance(glfwGetTime(), [&](float dt) {
+            scene.update(dt);
+            simulated += dt;
+        });
+        scene.animate(simulated);
+        ppgso::profiler::end();
 
         // Render scene
-        scene.render();
+        ppgso::profiler::begin("render");
+        scene.render(alpha);
+        ppgso::profiler::end();
+
+        ppgso::profiler::end();
+        ppgso::profiler::endFrame();
 
         // Swap buffers
         glfwSwapBuffers(window);
+        timestep.waitFrame();
         glfwPollEvents();
 
         // Exit on ESC
@@ -22,7 +22,11 @@ Asteroid::Asteroid() {
   // Initialize static resources if needed
   if (!shader) shader = std::make_unique<ppgso::Shader>(diffuse_vert_glsl, diffuse_frag_glsl);
   if (!texture) texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("asteroid.bmp"));
-  if (!mesh) mesh = std::make_unique<ppgso::Mesh>("asteroid.obj");
+  if (!mesh) mesh = std::make_unique<ppgso::Mesh>("asteroid.obj", 4);
+
+  // Bounding sphere around the object origin from the mesh bounds
+  auto &bounds = mesh->getBounds();
+  radius = glm::length(bounds.center) + bounds.radius;
 }
 
 bool Asteroid::update(Scene &scene, float dt) {
@@ -52,8 +56,8 @@ bool Asteroid::update(Scene &scene, float dt) {
     // This prevents excessive collisions when asteroids explode.
     if (asteroid && age < 0.5f) continue;
 
-    // Compare distance to approximate size of the asteroid estimated from scale.
-    if (distance(position, obj->position) < (obj->scale.y + scale.y) * 0.7f) {
+    // Compare distance to the sum of the bounding sphere radii
+    if (distance(position, obj->position) < obj->getBoundingRadius() + getBoundingRadius()) {
       int pieces = 3;
 
       // Too small to split into pieces
@@ -99,17 +103,13 @@ void Asteroid::explode(Scene &scene, glm::vec3 explosionPosition, glm::vec3 expl
 void Asteroid::render(Scene &scene) {
   shader->use();
 
-  // Set up light
-  shader->setUniform("LightDirection", scene.lightDirection);
-
-  // use camera
-  shader->setUniform("ProjectionMatrix", scene.camera->projectionMatrix);
-  shader->setUniform("ViewMatrix", scene.camera->viewMatrix);
-
   // render mesh
   shader->setUniform("ModelMatrix", modelMatrix);
   shader->setUniform("Texture", *texture);
-  mesh->render();
+
+  // Small and distant asteroids use simplified geometry
+  auto lod = mesh->selectLod(distance(scene.camera->position, position) / scale.y, lodDistance);
+  mesh->render(lod);
 }
 
 void Asteroid::onClick(Scene &scene) {
@@ -26,6 +26,9 @@ private:
   glm::vec3 speed;
   glm::vec3 rotMomentum;
 
+  // Distance relative to scale up to which the full detail mesh is rendered
+  static constexpr float lodDistance = 6.0f;
+
   /*!
    * Split the asteroid into multiple pieces and spawn an explosion object.
    *
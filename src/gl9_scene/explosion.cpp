@@ -28,28 +28,24 @@ void Explosion::render(Scene &scene) {
   // Transparency, interpolate from 1.0f -> 0.0f
   shader->setUniform("Transparency", 1.0f - age / maxAge);
 
-  // use camera
-  shader->setUniform("ProjectionMatrix", scene.camera->projectionMatrix);
-  shader->setUniform("ViewMatrix", scene.camera->viewMatrix);
-
   // render mesh
   shader->setUniform("ModelMatrix", modelMatrix);
   shader->setUniform("Texture", *texture);
 
   // Disable depth testing
-  glDisable(GL_DEPTH_TEST);
+  ppgso::state::setDepthTest(false);
 
   // Enable blending
-  glEnable(GL_BLEND);
+  ppgso::state::setBlend(true);
   // Additive blending
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+  ppgso::state::setBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
   mesh->render();
 
   // Disable blending
-  glDisable(GL_BLEND);
+  ppgso::state::setBlend(false);
   // Enable depth test
-  glEnable(GL_DEPTH_TEST);
+  ppgso::state::setDepthTest(true);
 }
 
 bool Explosion::update(Scene &scene, float dt) {
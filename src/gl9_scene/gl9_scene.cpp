@@ -4,7 +4,8 @@
 // - Creates a simple game scene with Player, Asteroid and Space objects
 // - Contains a generator object that does not render but adds Asteroids to the scene
 // - Some objects use shared resources and all object deallocations are handled automatically
-// - Controls: LEFT, RIGHT, "R" to reset, SPACE to fire
+// - Controls: LEFT, RIGHT, "R" to reset, SPACE to fire, "I" to print GL state changes of the last frame,
+//   "T" to toggle the frame profiler report
 
 #include <iostream>
 #include <map>
@@ -28,6 +29,12 @@ private:
   Scene scene;
   bool animate = true;
 
+  // Scene simulation advances in fixed steps independent of the frame rate
+  ppgso::FixedTimestep timestep;
+
+  // GL state changes of the last rendered frame
+  ppgso::state::Counters stateCounters;
+
   /*!
    * Reset and initialize the game scene
    * Creating unique smart pointers to objects that are stored in the scene object list
@@ -64,7 +71,7 @@ public:
 
     // Initialize OpenGL state
     // Enable Z-buffer
-    glEnable(GL_DEPTH_TEST);
+    ppgso::state::setDepthTest(true);
     glDepthFunc(GL_LEQUAL);
 
     // Enable polygon culling
@@ -94,6 +101,17 @@ public:
     if (key == GLFW_KEY_P && action == GLFW_PRESS) {
       animate = !animate;
     }
+
+    // Frame profiler
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+      ppgso::profiler::setEnabled(!ppgso::profiler::isEnabled());
+    }
+
+    // Print state changes
+    if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+      std::cout << "GL state changes issued: " << stateCounters.issued
+                << ", elided: " << stateCounters.elided << std::endl;
+    }
   }
 
   /*!
@@ -144,22 +162,27 @@ public:
    * Window update implementation that will be called automatically from pollEvents
    */
   void onIdle() override {
-    // Track time
-    static auto time = (float) glfwGetTime();
-
-    // Compute time delta
-    float dt = animate ? (float) glfwGetTime() - time : 0;
-
-    time = (float) glfwGetTime();
-
     // Set gray background
     glClearColor(.5f, .5f, .5f, 0);
     // Clear depth and color buffers
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Update and render all objects
-    scene.update(dt);
-    scene.render();
+    {
+      ppgso::profiler::Scope profile{"update"};
+      // Paused scene still updates the camera, the clock keeps running so it does not jump on resume
+      timestep.advance(glfwGetTime(), [this](float dt) {
+        if (animate) scene.update(dt);
+      });
+      if (!animate) scene.update(0);
+    }
+    {
+      ppgso::profiler::Scope profile{"render"};
+      scene.render();
+    }
+
+    stateCounters = ppgso::state::getCounters();
+    ppgso::state::resetCounters();
   }
 };
 
@@ -12,3 +12,7 @@ void Object::generateModelMatrix() {
           * glm::orientate4(rotation)
           * glm::scale(glm::mat4(1.0f), scale);
 }
+
+float Object::getBoundingRadius() const {
+  return radius * glm::max(scale.x, glm::max(scale.y, scale.z));
+}
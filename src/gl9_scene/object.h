@@ -43,12 +43,23 @@ public:
    */
   virtual void onClick(Scene &scene) {};
 
+  /*!
+   * Get radius of the bounding sphere in the scene, enlarged by the largest scale component
+   * so that it encloses the geometry for any non-uniform scale
+   *
+   * @return - Radius used for collisions and picking
+   */
+  float getBoundingRadius() const;
+
   // Object properties
   glm::vec3 position{0,0,0};
   glm::vec3 rotation{0,0,0};
   glm::vec3 scale{1,1,1};
   glm::mat4 modelMatrix{1};
 
+  // Radius of a sphere around the origin enclosing the unscaled geometry
+  float radius{1.0f};
+
 protected:
   /*!
    * Generate modelMatrix from position, rotation and scale
@@ -20,6 +20,10 @@ Player::Player() {
   if (!shader) shader = std::make_unique<ppgso::Shader>(diffuse_vert_glsl, diffuse_frag_glsl);
   if (!texture) texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("corsair.bmp"));
   if (!mesh) mesh = std::make_unique<ppgso::Mesh>("corsair.obj");
+
+  // Bounding sphere around the object origin from the mesh bounds
+  auto &bounds = mesh->getBounds();
+  radius = glm::length(bounds.center) + bounds.radius;
 }
 
 bool Player::update(Scene &scene, float dt) {
@@ -78,13 +82,6 @@ bool Player::update(Scene &scene, float dt) {
 void Player::render(Scene &scene) {
   shader->use();
 
-  // Set up light
-  shader->setUniform("LightDirection", scene.lightDirection);
-
-  // use camera
-  shader->setUniform("ProjectionMatrix", scene.camera->projectionMatrix);
-  shader->setUniform("ViewMatrix", scene.camera->viewMatrix);
-
   // render mesh
   shader->setUniform("ModelMatrix", modelMatrix);
   shader->setUniform("Texture", *texture);
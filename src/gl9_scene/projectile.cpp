@@ -20,6 +20,10 @@ Projectile::Projectile() {
   if (!shader) shader = std::make_unique<ppgso::Shader>(diffuse_vert_glsl, diffuse_frag_glsl);
   if (!texture) texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("missile.bmp"));
   if (!mesh) mesh = std::make_unique<ppgso::Mesh>("missile.obj");
+
+  // Bounding sphere around the object origin from the mesh bounds
+  auto &bounds = mesh->getBounds();
+  radius = glm::length(bounds.center) + bounds.radius;
 }
 
 bool Projectile::update(Scene &scene, float dt) {
@@ -43,13 +47,6 @@ bool Projectile::update(Scene &scene, float dt) {
 void Projectile::render(Scene &scene) {
   shader->use();
 
-  // Set up light
-  shader->setUniform("LightDirection", scene.lightDirection);
-
-  // use camera
-  shader->setUniform("ProjectionMatrix", scene.camera->projectionMatrix);
-  shader->setUniform("ViewMatrix", scene.camera->viewMatrix);
-
   // render mesh
   shader->setUniform("ModelMatrix", modelMatrix);
   shader->setUniform("Texture", *texture);
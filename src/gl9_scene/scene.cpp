@@ -17,6 +17,15 @@ void Scene::update(float time) {
 }
 
 void Scene::render() {
+  // Upload camera and light shared by all objects
+  ppgso::FrameUniforms uniforms;
+  uniforms.projectionMatrix = camera->projectionMatrix;
+  uniforms.viewMatrix = camera->viewMatrix;
+  uniforms.lightDirection = glm::vec4{lightDirection, 0.0f};
+  if (!frame) frame = std::make_unique<ppgso::UniformBuffer>("Frame", sizeof(uniforms));
+  frame->bind();
+  frame->update(uniforms);
+
   // Simply render all objects
   for ( auto& obj : objects )
     obj->render(*this);
@@ -25,9 +34,9 @@ void Scene::render() {
 std::vector<Object*> Scene::intersect(const glm::vec3 &position, const glm::vec3 &direction) {
   std::vector<Object*> intersected = {};
   for(auto& object : objects) {
-    // Collision with sphere of size object->scale.x
+    // Collision with the bounding sphere of the object
     auto oc = position - object->position;
-    auto radius = object->scale.x;
+    auto radius = object->getBoundingRadius();
     auto a = glm::dot(direction, direction);
     auto b = glm::dot(oc, direction);
     auto c = glm::dot(oc, oc) - radius * radius;
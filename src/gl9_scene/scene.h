@@ -37,6 +37,9 @@ class Scene {
     // Camera object
     std::unique_ptr<Camera> camera;
 
+    // Camera and light uploaded once per frame for all objects
+    std::unique_ptr<ppgso::UniformBuffer> frame;
+
     // All objects to be rendered in scene
     std::list< std::unique_ptr<Object> > objects;
 
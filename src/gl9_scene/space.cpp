@@ -9,6 +9,10 @@ Space::Space() {
   if (!shader) shader = std::make_unique<ppgso::Shader>(texture_vert_glsl, texture_frag_glsl);
   if (!texture) texture = std::make_unique<ppgso::Texture>(ppgso::image::loadBMP("stars.bmp"));
   if (!mesh) mesh = std::make_unique<ppgso::Mesh>("quad.obj");
+
+  // Identity projection and view
+  if (!frame) frame = std::make_unique<ppgso::UniformBuffer>("Frame", sizeof(ppgso::FrameUniforms));
+  frame->update(ppgso::FrameUniforms{});
 }
 
 bool Space::update(Scene &scene, float dt) {
@@ -21,7 +25,7 @@ bool Space::update(Scene &scene, float dt) {
 
 void Space::render(Scene &scene) {
   // Disable writing to the depth buffer so we render a "background"
-  glDepthMask(GL_FALSE);
+  ppgso::state::setDepthMask(false);
 
   // NOTE: this object does not use camera, just renders the entire quad as is
   shader->use();
@@ -30,16 +34,19 @@ void Space::render(Scene &scene) {
   shader->setUniform("TextureOffset", textureOffset);
 
   // Render mesh, not using any projections, we just render in 2D
+  frame->bind();
   shader->setUniform("ModelMatrix", modelMatrix);
-  shader->setUniform("ViewMatrix", glm::mat4{1.0f});
-  shader->setUniform("ProjectionMatrix", glm::mat4{1.0f});
   shader->setUniform("Texture", *texture);
   mesh->render();
 
-  glDepthMask(GL_TRUE);
+  // Restore camera of the scene for the other objects
+  scene.frame->bind();
+
+  ppgso::state::setDepthMask(true);
 }
 
 // shared resources
 std::unique_ptr<ppgso::Mesh> Space::mesh;
 std::unique_ptr<ppgso::Shader> Space::shader;
 std::unique_ptr<ppgso::Texture> Space::texture;
+std::unique_ptr<ppgso::UniformBuffer> Space::frame;
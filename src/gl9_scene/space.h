@@ -16,6 +16,7 @@ private:
   static std::unique_ptr<ppgso::Mesh> mesh;
   static std::unique_ptr<ppgso::Shader> shader;
   static std::unique_ptr<ppgso::Texture> texture;
+  static std::unique_ptr<ppgso::UniformBuffer> frame;
 
   glm::vec2 textureOffset;
 public:
@@ -2,12 +2,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <random>
 #include <cmath>
+#include <algorithm>
 
 #include <shaders/ocean_vert_glsl.h>
 #include <shaders/ocean_frag_glsl.h>
 
 // Static member initialization
-std::unique_ptr<ppgso::Shader> Ocean::shader;
+std::map<unsigned int, std::unique_ptr<ppgso::Shader>> Ocean::shaders;
 int Ocean::instanceCount = 0;
 
 Ocean::Ocean(float size, int resolution, float waveHeight)
@@ -15,9 +16,13 @@ Ocean::Ocean(float size, int resolution, float waveHeight)
 
     instanceCount++;
 
-    // Initialize shader only once
+    // Initialize shader only once, compiled in the background until first render
+    auto &shader = shaders[getFeatures()];
     if (!shader) {
-        shader = std::make_unique<ppgso::Shader>(ocean_vert_glsl, ocean_frag_glsl);
+        shader = std::make_unique<ppgso::Shader>(ocean_vert_glsl,
+                                                 ppgso::Shader::variant(ocean_frag_glsl_variants, getFeatures()),
+                                                 true);
+        shader->watch("ocean_vert.glsl", "ocean_frag.glsl");
     }
 
     // Initialize wave parameters
@@ -28,7 +33,7 @@ Ocean::Ocean(float size, int resolution, float waveHeight)
 
     // Setup OpenGL buffers
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    ppgso::state::bindVertexArray(vao);
 
     // VBO: positions
     glGenBuffers(1, &vbo);
@@ -57,13 +62,12 @@ Ocean::Ocean(float size, int resolution, float waveHeight)
     // EBO: indices
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
                  indices.data(), GL_STATIC_DRAW);
-
-    indexCount = indices.size();
 }
 
 Ocean::~Ocean() {
+    ppgso::state::releaseVertexArray(vao);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &nbo);
@@ -73,7 +77,7 @@ Ocean::~Ocean() {
     instanceCount--;
 
     if (instanceCount == 0) {
-        shader.reset();
+        shaders.clear();
     }
 }
 
@@ -145,6 +149,7 @@ void Ocean::generateMesh() {
     normals.clear();
     uvs.clear();
     indices.clear();
+    indexChunks.clear();
 
     // Generate flat grid (will be displaced in update)
     for (int z = 0; z <= resolution; z++) {
@@ -160,17 +165,32 @@ void Ocean::generateMesh() {
         }
     }
 
-    // Generate indices
-    for (int z = 0; z < resolution; z++) {
-        for (int x = 0; x < resolution; x++) {
-            int i0 = z * (resolution + 1) + x;
-            int i1 = i0 + 1;
-            int i2 = i0 + (resolution + 1);
-            int i3 = i2 + 1;
+    // Generate indices in chunks of rows addressable by 16 bit indices
+    int rowsPerChunk = 65536 / (resolution + 1) - 1;
+    if (rowsPerChunk < 1)
+        throw std::runtime_error("Ocean resolution too large for 16 bit index chunks!");
+
+    for (int z0 = 0; z0 < resolution; z0 += rowsPerChunk) {
+        int z1 = std::min(z0 + rowsPerChunk, resolution);
+
+        IndexChunk chunk;
+        chunk.offset = indices.size() * sizeof(GLushort);
+        chunk.baseVertex = z0 * (resolution + 1);
 
-            indices.push_back(i0); indices.push_back(i2); indices.push_back(i1);
-            indices.push_back(i1); indices.push_back(i2); indices.push_back(i3);
+        for (int z = z0; z < z1; z++) {
+            for (int x = 0; x < resolution; x++) {
+                int i0 = (z - z0) * (resolution + 1) + x;
+                int i1 = i0 + 1;
+                int i2 = i0 + (resolution + 1);
+                int i3 = i2 + 1;
+
+                indices.push_back(i0); indices.push_back(i2); indices.push_back(i1);
+                indices.push_back(i1); indices.push_back(i2); indices.push_back(i3);
+            }
         }
+
+        chunk.count = (GLsizei)(indices.size() - chunk.offset / sizeof(GLushort));
+        indexChunks.push_back(chunk);
     }
 }
 
@@ -197,7 +217,7 @@ void Ocean::updateMesh(float dt) {
     }
 
     // Update GPU buffers
-    glBindVertexArray(vao);
+    ppgso::state::bindVertexArray(vao);
     
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferSubData(GL_ARRAY_BUFFER, 0, 
@@ -215,13 +235,22 @@ void Ocean::update(float dt) {
     updateMesh(dt);
 }
 
-void Ocean::render(const glm::mat4 &view, const glm::mat4 &projection) {
+unsigned int Ocean::getFeatures() const {
+    return (foam ? OCEAN_FRAG_GLSL_FOAM : 0u) | (fresnel ? OCEAN_FRAG_GLSL_FRESNEL : 0u);
+}
+
+void Ocean::render() {
+    // Variants are compiled when first used
+    auto &shader = shaders[getFeatures()];
+    if (!shader) {
+        shader = std::make_unique<ppgso::Shader>(ocean_vert_glsl,
+                                                 ppgso::Shader::variant(ocean_frag_glsl_variants, getFeatures()));
+        shader->watch("ocean_vert.glsl", "ocean_frag.glsl");
+    }
     shader->use();
     
-    // Set matrices
+    // Set model matrix, camera matrices come from the frame uniform buffer
     shader->setUniform("modelMatrix", glm::mat4(1.0f));
-    shader->setUniform("viewMatrix", view);
-    shader->setUniform("projectionMatrix", projection);
     
     // Set water properties
     shader->setUniform("waterColor", waterColor);
@@ -230,16 +259,19 @@ void Ocean::render(const glm::mat4 &view, const glm::mat4 &projection) {
     shader->setUniform("time", time);
     
     // Enable blending for transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    ppgso::state::setBlend(true);
+    ppgso::state::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     // Disable depth writing (but keep depth testing)
-    glDepthMask(GL_FALSE);
+    ppgso::state::setDepthMask(false);
     
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+    ppgso::state::bindVertexArray(vao);
+    for (const auto &chunk : indexChunks) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, chunk.count, GL_UNSIGNED_SHORT,
+                                 reinterpret_cast<const void *>(chunk.offset), chunk.baseVertex);
+    }
     
     // Restore depth writing
-    glDepthMask(GL_TRUE);
-    glDisable(GL_BLEND);
+    ppgso::state::setDepthMask(true);
+    ppgso::state::setBlend(false);
 }
\ No newline at end of file
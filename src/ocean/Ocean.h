@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
+#include <map>
 
 class Ocean {
 public:
@@ -15,7 +16,8 @@ public:
     ~Ocean();
 
     void update(float dt);
-    void render(const glm::mat4 &view, const glm::mat4 &projection);
+    // Camera matrices are read from the bound "Frame" uniform buffer
+    void render();
 
     // Wave parameters
     void setWaveSpeed(float speed) { waveSpeed = speed; }
@@ -27,6 +29,11 @@ public:
     void setFoamColor(const glm::vec3& color) { foamColor = color; }
     void setTransparency(float alpha) { transparency = alpha; }
 
+    // Shader features, disabled features are compiled out of the fragment shader
+    void setFoam(bool enabled) { foam = enabled; }
+    void setFresnel(bool enabled) { fresnel = enabled; }
+    bool getFoam() const { return foam; }
+
     // Get height at position (for foam/intersection detection)
     float getHeightAt(float worldX, float worldZ, float time) const;
 
@@ -35,11 +42,18 @@ private:
     std::vector<glm::vec3> positions;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> uvs;
-    std::vector<unsigned int> indices;
+    std::vector<GLushort> indices;
+
+    // Grid rows are split into chunks small enough to be addressed by 16 bit indices
+    struct IndexChunk {
+        GLsizei count;      // Number of indices in the chunk
+        size_t offset;      // Byte offset of the chunk in the index buffer
+        GLint baseVertex;   // First vertex of the chunk, added to its indices when drawing
+    };
+    std::vector<IndexChunk> indexChunks;
 
     // OpenGL buffers
     GLuint vao = 0, vbo = 0, nbo = 0, tbo = 0, ebo = 0;
-    size_t indexCount = 0;
 
     // Ocean parameters
     float size;
@@ -53,6 +67,8 @@ private:
     glm::vec3 waterColor = glm::vec3(0.1f, 0.3f, 0.5f);
     glm::vec3 foamColor = glm::vec3(0.9f, 0.95f, 1.0f);
     float transparency = 0.7f;
+    bool foam = true;
+    bool fresnel = true;
 
     // Wave functions
     struct Wave {
@@ -72,7 +88,8 @@ private:
     void updateMesh(float dt);
     void computeNormals();
 
-    // Shader (shared across all ocean instances)
-    static std::unique_ptr<ppgso::Shader> shader;
+    // Shader variants by fragment shader features (shared across all ocean instances)
+    static std::map<unsigned int, std::unique_ptr<ppgso::Shader>> shaders;
+    unsigned int getFeatures() const;
     static int instanceCount;
 };
\ No newline at end of file
@@ -1,14 +1,22 @@
 #include "Terrain.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <random>
 
-#include <shaders/terrain_vert_glsl.h>
+#include <shaders/terrain_height_vert_glsl.h>
 #include <shaders/terrain_frag_glsl.h>
+#include <shaders/terrain_gen_vert_glsl.h>
+#include <shaders/terrain_gen_frag_glsl.h>
+#include <shaders/terrain_normal_frag_glsl.h>
 
 // Static member initialization
 std::unique_ptr<ppgso::Shader> Terrain::shader;
+std::unique_ptr<ppgso::Shader> Terrain::heightShader;
+std::unique_ptr<ppgso::Shader> Terrain::normalShader;
 int Terrain::instanceCount = 0;
 std::vector<int> Terrain::permutation;
 
@@ -17,8 +25,10 @@ Terrain::Terrain(int resolution, float size, float height, TerrainType type)
 
     instanceCount++;
 
+    // Compile in the background while the terrain is generated, finished on first render
     if (!shader) {
-        shader = std::make_unique<ppgso::Shader>(terrain_vert_glsl, terrain_frag_glsl);
+        shader = std::make_unique<ppgso::Shader>(terrain_height_vert_glsl, terrain_frag_glsl, true);
+        shader->watch("terrain_height_vert.glsl", "terrain_frag.glsl");
     }
 
     if (permutation.empty()) {
@@ -38,86 +48,171 @@ Terrain::Terrain(int resolution, float size, float height, TerrainType type)
 
     initVoronoiCells();
     generateGrid();
-    computeNormals();
+    generateSurface();
+    generateLodPatterns();
+    updateChunkBounds();
 
     // Setup OpenGL buffers
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    ppgso::state::bindVertexArray(vao);
 
     glGenBuffers(1, &vbo);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3),
-                 positions.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), nullptr, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 0, nullptr);
 
     glGenBuffers(1, &nbo);
     glBindBuffer(GL_ARRAY_BUFFER, nbo);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3),
-                 normals.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-    glGenBuffers(1, &tbo);
-    glBindBuffer(GL_ARRAY_BUFFER, tbo);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2),
-                 uvs.data(), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE, 0, nullptr);
 
     glGenBuffers(1, &ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
                  indices.data(), GL_STATIC_DRAW);
 
-    indexCount = indices.size();
+    updateBuffers();
 }
 
 Terrain::~Terrain() {
+    ppgso::state::releaseVertexArray(vao);
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &nbo);
-    glDeleteBuffers(1, &tbo);
     glDeleteBuffers(1, &ebo);
 
+    if (gpuFramebuffer) {
+        glDeleteFramebuffers(1, &gpuFramebuffer);
+        ppgso::state::releaseVertexArray(gpuVao);
+        glDeleteVertexArrays(1, &gpuVao);
+        for (auto texture : gpuTextures) ppgso::state::releaseTexture(texture);
+        glDeleteTextures(GPU_TEXTURES, gpuTextures);
+    }
+
     instanceCount--;
 
     if (instanceCount == 0) {
         shader.reset();
+        heightShader.reset();
+        normalShader.reset();
         permutation.clear();
     }
 }
 
 void Terrain::update(float) {}
 
-void Terrain::render(const glm::mat4 &view, const glm::mat4 &projection) {
+void Terrain::render() {
+    for (auto &chunk : chunks) chunk.level = 0;
+
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    renderedTriangles = 0;
+    for (auto &chunk : chunks) {
+        auto &pattern = lodPatterns[0];
+        drawCounts.push_back(pattern.count);
+        drawOffsets.push_back(reinterpret_cast<const void *>(pattern.offset));
+        drawBaseVertices.push_back(chunk.baseVertex);
+        renderedTriangles += pattern.count / 3;
+    }
+
+    drawBatch();
+}
+
+void Terrain::render(const glm::vec3 &eye, const glm::mat4 &viewProjection) {
+    // Level of detail from the distance to the closest point of each chunk
+    for (auto &chunk : chunks) {
+        float distance = glm::distance(eye, glm::clamp(eye, chunk.min, chunk.max));
+        chunk.level = distance <= lodDistance ? 0 : 1 + (int) std::log2(distance / lodDistance);
+        chunk.level = std::min(chunk.level, lodLevels - 1);
+    }
+
+    // Neighbors may differ by one level at most so that stitching closes every crack
+    auto level = [&](int x, int z) {
+        if (x < 0 || z < 0 || x >= chunksPerSide || z >= chunksPerSide) return -1;
+        return chunks[z * chunksPerSide + x].level;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int z = 0; z < chunksPerSide; z++) {
+            for (int x = 0; x < chunksPerSide; x++) {
+                auto &chunk = chunks[z * chunksPerSide + x];
+                int coarsest = std::max(std::max(level(x - 1, z), level(x + 1, z)),
+                                        std::max(level(x, z - 1), level(x, z + 1)));
+                if (chunk.level < coarsest - 1) {
+                    chunk.level = coarsest - 1;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Collect chunks inside the frustum, whole quadtree branches are skipped at once
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    renderedTriangles = 0;
+
+    auto frustum = ppgso::computeFrustum(viewProjection);
+    std::vector<int> stack{0};
+    while (!stack.empty()) {
+        auto &node = quadtree[stack.back()];
+        stack.pop_back();
+        if (!ppgso::intersects(frustum, node.min, node.max)) continue;
+
+        if (node.children[0] >= 0) {
+            for (int child : node.children)
+                if (child >= 0) stack.push_back(child);
+            continue;
+        }
+
+        int x = node.x0, z = node.z0;
+        auto &chunk = chunks[z * chunksPerSide + x];
+        int mask = (level(x - 1, z) > chunk.level ? 1 : 0) | (level(x + 1, z) > chunk.level ? 2 : 0) |
+                   (level(x, z - 1) > chunk.level ? 4 : 0) | (level(x, z + 1) > chunk.level ? 8 : 0);
+        auto &pattern = lodPatterns[chunk.level * 16 + mask];
+        drawCounts.push_back(pattern.count);
+        drawOffsets.push_back(reinterpret_cast<const void *>(pattern.offset));
+        drawBaseVertices.push_back(chunk.baseVertex);
+        renderedTriangles += pattern.count / 3;
+    }
+
+    if (drawCounts.empty()) return;
+
+    drawBatch();
+}
+
+void Terrain::drawBatch() {
     shader->use();
     shader->setUniform("modelMatrix", glm::mat4(1.f));
-    shader->setUniform("viewMatrix", view);
-    shader->setUniform("projectionMatrix", projection);
+    shader->setUniform("size", size);
+    glUniform1i(shader->getUniformLocation("resolution"), resolution);
 
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+    ppgso::state::bindVertexArray(vao);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(),
+                                  (GLsizei) drawCounts.size(), drawBaseVertices.data());
 }
 
 // ===================== Perlin Noise Implementation =========================
 
-float Terrain::fade(float t) {
+float Terrain::fade(float t) const {
     return t * t * t * (t * (t * 6 - 15) + 10);
 }
 
-float Terrain::lerp(float t, float a, float b) {
+float Terrain::lerp(float t, float a, float b) const {
     return a + t * (b - a);
 }
 
-float Terrain::grad(int hash, float x, float y) {
+float Terrain::grad(int hash, float x, float y) const {
     int h = hash & 7;
     float u = h < 4 ? x : y;
     float v = h < 4 ? y : x;
     return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
 }
 
-float Terrain::perlin(float x, float y) {
+float Terrain::perlin(float x, float y) const {
     int X = (int)floor(x) & 255;
     int Y = (int)floor(y) & 255;
 
@@ -144,7 +239,7 @@ float Terrain::perlin(float x, float y) {
 
 // ===================== Noise Algorithms =========================
 
-float Terrain::fbm(float x, float y, int octaves) {
+float Terrain::fbm(float x, float y, int octaves) const {
     float value = 0.f;
     float amplitude = 0.5f;
     float frequency = noiseFrequency;
@@ -158,36 +253,81 @@ float Terrain::fbm(float x, float y, int octaves) {
     return value;
 }
 
-float Terrain::ridged(float x, float y) {
+float Terrain::ridged(float x, float y) const {
     float h = fbm(x, y, 6);
     h = 1.f - fabs(h);
     return h * h;
 }
 
-void Terrain::initVoronoiCells() {
-    voronoiCells.clear();
-    std::random_device rd;
+void Terrain::initVoronoiCells(int count) {
     std::mt19937 gen(12345);
     std::uniform_real_distribution<> dis(0.0, 1.0);
 
-    for (int i = 0; i < 64; i++) {
-        voronoiCells.push_back(glm::vec2(dis(gen), dis(gen)) * size);
+    std::vector<glm::vec2> cells;
+    glm::vec2 lo{1e9f}, hi{-1e9f};
+    for (int i = 0; i < count; i++) {
+        cells.push_back(glm::vec2(dis(gen), dis(gen)) * size);
+        lo = glm::min(lo, cells.back());
+        hi = glm::max(hi, cells.back());
     }
+
+    // About one cell per bucket
+    voronoiBucketSize = size / std::sqrt((float) std::max(count, 1));
+    voronoiOrigin = lo;
+    voronoiBuckets = glm::max(glm::ivec2(glm::ceil((hi - lo) / voronoiBucketSize)), glm::ivec2(1));
+
+    auto bucket = [&](glm::vec2 cell) {
+        auto b = glm::min(glm::ivec2((cell - voronoiOrigin) / voronoiBucketSize), voronoiBuckets - 1);
+        return b.y * voronoiBuckets.x + b.x;
+    };
+
+    // Counting sort of the cells by bucket
+    voronoiBucketStart.assign(voronoiBuckets.x * voronoiBuckets.y + 1, 0);
+    for (auto &cell : cells) voronoiBucketStart[bucket(cell) + 1]++;
+    for (size_t i = 1; i < voronoiBucketStart.size(); i++) voronoiBucketStart[i] += voronoiBucketStart[i - 1];
+
+    voronoiCells.resize(cells.size());
+    auto next = voronoiBucketStart;
+    for (auto &cell : cells) voronoiCells[next[bucket(cell)]++] = cell;
 }
 
-float Terrain::voronoi(float x, float y) {
+float Terrain::voronoi(float x, float y) const {
     glm::vec2 p(x, y);
-    float minDist = 1e9f;
+    float maxDist = size * 0.1f;
+
+    // Cells farther than maxDist all give zero
+    glm::vec2 lo = voronoiOrigin;
+    glm::vec2 hi = voronoiOrigin + glm::vec2(voronoiBuckets) * voronoiBucketSize;
+    glm::vec2 outside = glm::max(glm::max(lo - p, p - hi), glm::vec2(0.f));
+    if (glm::dot(outside, outside) >= maxDist * maxDist) return 0.f;
+
+    // Visit rings of buckets around the sample until the unvisited ones are farther than the closest cell.
+    // Squared distances are compared and only the closest one is square rooted.
+    glm::ivec2 center(glm::floor((p - voronoiOrigin) / voronoiBucketSize));
+    float minDist2 = 1e18f;
+    for (int ring = 0;; ring++) {
+        for (int j = center.y - ring; j <= center.y + ring; j++) {
+            if (j < 0 || j >= voronoiBuckets.y) continue;
+            int stride = (j == center.y - ring || j == center.y + ring) ? 1 : 2 * ring;
+            for (int i = center.x - ring; i <= center.x + ring; i += stride) {
+                if (i < 0 || i >= voronoiBuckets.x) continue;
+
+                int b = j * voronoiBuckets.x + i;
+                for (int c = voronoiBucketStart[b]; c < voronoiBucketStart[b + 1]; c++) {
+                    glm::vec2 d = p - voronoiCells[c];
+                    minDist2 = std::min(minDist2, glm::dot(d, d));
+                }
+            }
+        }
 
-    for (const auto& cell : voronoiCells) {
-        float d = glm::distance(p, cell);
-        minDist = std::min(minDist, d);
+        float reach = ring * voronoiBucketSize;
+        if (reach * reach >= std::min(minDist2, maxDist * maxDist)) break;
     }
 
-    return 1.f - glm::clamp(minDist / (size * 0.1f), 0.f, 1.f);
+    return 1.f - glm::clamp(std::sqrt(minDist2) / maxDist, 0.f, 1.f);
 }
 
-float Terrain::canyon(float x, float y) {
+float Terrain::canyon(float x, float y) const {
     float base = fbm(x * 0.02f, y * 0.02f, 4);
     float detail = fbm(x * 0.1f, y * 0.1f, 3);
 
@@ -197,7 +337,7 @@ float Terrain::canyon(float x, float y) {
     return base * channel + detail * 0.2f;
 }
 
-float Terrain::plateaus(float x, float y) {
+float Terrain::plateaus(float x, float y) const {
     float h = fbm(x * 0.03f, y * 0.03f, 5);
 
     const int steps = 5;
@@ -208,6 +348,160 @@ float Terrain::plateaus(float x, float y) {
     return h;
 }
 
+// ===================== Batched Noise =========================
+
+void Terrain::perlin(const float *x, const float *y, float *out, int count) const {
+    const int *p = permutation.data();
+
+    // Same arithmetic as the scalar version, permutation lookups become gathers
+    #pragma omp simd
+    for (int i = 0; i < count; i++) {
+        // Floor by truncation and correction, vectorizes without SSE4.1
+        int ix = (int)x[i];
+        int iy = (int)y[i];
+        ix -= x[i] < (float)ix;
+        iy -= y[i] < (float)iy;
+        float fx = (float)ix;
+        float fy = (float)iy;
+        int X = ix & 255;
+        int Y = iy & 255;
+
+        float xf = x[i] - fx;
+        float yf = y[i] - fy;
+
+        float u = fade(xf);
+        float v = fade(yf);
+
+        int A  = p[X] + Y;
+        int AA = p[A];
+        int AB = p[A + 1];
+        int B  = p[X + 1] + Y;
+        int BA = p[B];
+        int BB = p[B + 1];
+
+        out[i] = lerp(v,
+            lerp(u, grad(p[AA], xf, yf),
+                    grad(p[BA], xf - 1, yf)),
+            lerp(u, grad(p[AB], xf, yf - 1),
+                    grad(p[BB], xf - 1, yf - 1))
+        );
+    }
+}
+
+void Terrain::fbm(const float *x, const float *y, float *out, int count, int octaves) const {
+    std::vector<float> sx(count), sy(count), noise(count);
+    float amplitude = 0.5f;
+    float frequency = noiseFrequency;
+
+    std::fill(out, out + count, 0.f);
+    for (int octave = 0; octave < octaves; octave++) {
+        #pragma omp simd
+        for (int i = 0; i < count; i++) {
+            sx[i] = x[i] * frequency;
+            sy[i] = y[i] * frequency;
+        }
+
+        perlin(sx.data(), sy.data(), noise.data(), count);
+
+        #pragma omp simd
+        for (int i = 0; i < count; i++)
+            out[i] += amplitude * noise[i];
+
+        frequency *= 2.f;
+        amplitude *= 0.5f;
+    }
+}
+
+void Terrain::ridged(const float *x, const float *y, float *out, int count) const {
+    fbm(x, y, out, count, 6);
+
+    #pragma omp simd
+    for (int i = 0; i < count; i++) {
+        float h = 1.f - std::fabs(out[i]);
+        out[i] = h * h;
+    }
+}
+
+void Terrain::canyon(const float *x, const float *y, float *out, int count) const {
+    std::vector<float> sx(count), sy(count), detail(count);
+
+    for (int i = 0; i < count; i++) {
+        sx[i] = x[i] * 0.02f;
+        sy[i] = y[i] * 0.02f;
+    }
+    fbm(sx.data(), sy.data(), out, count, 4);
+
+    for (int i = 0; i < count; i++) {
+        sx[i] = x[i] * 0.1f;
+        sy[i] = y[i] * 0.1f;
+    }
+    fbm(sx.data(), sy.data(), detail.data(), count, 3);
+
+    for (int i = 0; i < count; i++) {
+        float channel = sin(x[i] * 0.05f + detail[i] * 2.0f) * 0.5f + 0.5f;
+        channel = pow(channel, 3.0f);
+        out[i] = out[i] * channel + detail[i] * 0.2f;
+    }
+}
+
+void Terrain::plateaus(const float *x, const float *y, float *out, int count) const {
+    std::vector<float> sx(count), sy(count), detail(count);
+
+    for (int i = 0; i < count; i++) {
+        sx[i] = x[i] * 0.03f;
+        sy[i] = y[i] * 0.03f;
+    }
+    fbm(sx.data(), sy.data(), out, count, 5);
+
+    for (int i = 0; i < count; i++) {
+        sx[i] = x[i] * 0.2f;
+        sy[i] = y[i] * 0.2f;
+    }
+    fbm(sx.data(), sy.data(), detail.data(), count, 2);
+
+    const int steps = 5;
+    for (int i = 0; i < count; i++) {
+        out[i] = floor(out[i] * steps) / steps;
+        out[i] += detail[i] * 0.1f;
+    }
+}
+
+void Terrain::baseNoise(const float *x, const float *y, float *out, int count) const {
+    std::vector<float> sx, sy;
+
+    switch (type) {
+        case TerrainType::ISLAND:
+        case TerrainType::RIDGED: {
+            float scale = type == TerrainType::ISLAND ? 0.04f : 0.03f;
+            sx.resize(count);
+            sy.resize(count);
+            for (int i = 0; i < count; i++) {
+                sx[i] = x[i] * scale;
+                sy[i] = y[i] * scale;
+            }
+            if (type == TerrainType::ISLAND)
+                fbm(sx.data(), sy.data(), out, count, 6);
+            else
+                ridged(sx.data(), sy.data(), out, count);
+            break;
+        }
+        case TerrainType::VORONOI:
+            for (int i = 0; i < count; i++)
+                out[i] = voronoi(x[i], y[i]);
+            break;
+        case TerrainType::CANYON:
+            canyon(x, y, out, count);
+            break;
+        case TerrainType::PLATEAUS:
+            plateaus(x, y, out, count);
+            break;
+    }
+
+    // Normalize base noise to 0-1 range
+    for (int i = 0; i < count; i++)
+        out[i] = glm::clamp((out[i] + 1.0f) * 0.5f, 0.f, 1.f);
+}
+
 // ===================== Unified Island Generation =========================
 
 float Terrain::islandMask(float x, float y) {
@@ -249,49 +543,10 @@ float Terrain::coastlineVariation(float x, float y) {
     return glm::clamp(coastal, 0.f, 1.f);
 }
 
-float Terrain::erosionFilter(float height, float slope) {
-    float erosion = glm::clamp(slope * 2.0f, 0.f, 1.f);
-    return height * (1.0f - erosion * 0.3f);
-}
 
 // ===================== MAIN HEIGHT FUNCTION =========================
 
-float Terrain::finalHeight(float x, float y) {
-    // Normalized position
-    float nx = x / size;
-    float ny = y / size;
-    float distFromCenter = sqrt(nx * nx + ny * ny);
-
-    // Get island shape mask (handles non-circular shape)
-    float islandShape = islandMask(x, y);
-
-    // Base terrain using selected type
-    float baseNoise = 0.f;
-    switch (type) {
-        case TerrainType::ISLAND:
-            baseNoise = fbm(x * 0.04f, y * 0.04f, 6);
-            break;
-        case TerrainType::RIDGED:
-            baseNoise = ridged(x * 0.03f, y * 0.03f);
-            break;
-        case TerrainType::VORONOI:
-            baseNoise = voronoi(x, y);
-            break;
-        case TerrainType::CANYON:
-            baseNoise = canyon(x, y);
-            break;
-        case TerrainType::PLATEAUS:
-            baseNoise = plateaus(x, y);
-            break;
-    }
-
-    // Normalize base noise to 0-1 range
-    baseNoise = (baseNoise + 1.0f) * 0.5f;
-    baseNoise = glm::clamp(baseNoise, 0.f, 1.f);
-
-    // Coastal variation (determines beach vs cliff)
-    float coastType = coastlineVariation(x, y);
-
+float Terrain::finalHeight(float x, float y, float baseNoise, float islandShape, float coastType) {
     // === HEIGHT PROFILE ===
 
     // Ocean floor depth
@@ -366,6 +621,14 @@ float Terrain::finalHeight(float x, float y) {
     return elevation;
 }
 
+void Terrain::sampleHeights(const float *x, const float *z, float *out, int count) const {
+    baseNoise(x, z, out, count);
+
+    // Half of the noise range ends up below sea level
+    for (int i = 0; i < count; i++)
+        out[i] = (out[i] - 0.5f) * maxHeight;
+}
+
 float Terrain::getHeightAt(float worldX, float worldZ) const {
     float fx = (worldX / size + 0.5f) * resolution;
     float fz = (worldZ / size + 0.5f) * resolution;
@@ -400,45 +663,192 @@ float Terrain::getHeightAt(float worldX, float worldZ) const {
 // ===================== Mesh Generation =========================
 
 void Terrain::generateGrid() {
-    positions.clear();
-    normals.clear();
-    uvs.clear();
-    indices.clear();
+    size_t count = (size_t)(resolution + 1) * (resolution + 1);
+    positions.resize(count);
+    islandShapes.resize(count);
+    coastTypes.resize(count);
 
+    // Rows are independent and every vertex is written by one thread only, so the result matches the serial loop
+    #pragma omp parallel for schedule(dynamic, 4)
     for (int z = 0; z <= resolution; z++) {
+        float fz = (float)z / resolution;
+        float wz = (fz - 0.5f) * size;
         for (int x = 0; x <= resolution; x++) {
             float fx = (float)x / resolution;
-            float fz = (float)z / resolution;
             float wx = (fx - 0.5f) * size;
-            float wz = (fz - 0.5f) * size;
-            float wy = finalHeight(wx, wz);
 
-            positions.push_back({wx, wy, wz});
-            uvs.push_back({fx, fz});
+            size_t idx = (size_t)z * (resolution + 1) + x;
+            positions[idx] = {wx, 0.f, wz};
+            islandShapes[idx] = islandMask(wx, wz);
+            coastTypes[idx] = coastlineVariation(wx, wz);
         }
     }
+}
 
-    for (int z = 0; z < resolution; z++) {
-        for (int x = 0; x < resolution; x++) {
-            int i0 = z * (resolution + 1) + x;
-            int i1 = i0 + 1;
-            int i2 = i0 + (resolution + 1);
-            int i3 = i2 + 1;
+void Terrain::generateHeights(bool withNormals) {
+    int vertices = resolution + 1;
+    normals.resize(positions.size());
+
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(dynamic, 4)
+        for (int z = 0; z <= resolution; z++) {
+            // Base noise of the whole row is evaluated in one batch
+            std::vector<float> rowX(vertices), rowZ(vertices), rowNoise(vertices);
+            size_t row = (size_t)z * vertices;
+            for (int x = 0; x <= resolution; x++) {
+                rowX[x] = positions[row + x].x;
+                rowZ[x] = positions[row + x].z;
+            }
+            baseNoise(rowX.data(), rowZ.data(), rowNoise.data(), vertices);
+
+            for (int x = 0; x <= resolution; x++) {
+                size_t idx = row + x;
+                positions[idx].y = finalHeight(rowX[x], rowZ[x], rowNoise[x], islandShapes[idx], coastTypes[idx]);
+            }
+        }
 
-            indices.push_back(i0); indices.push_back(i2); indices.push_back(i1);
-            indices.push_back(i1); indices.push_back(i2); indices.push_back(i3);
+        // The loop above ends with a barrier so neighbor rows are done
+        if (withNormals) {
+            #pragma omp for schedule(static)
+            for (int z = 0; z <= resolution; z++) computeNormalRow(z);
         }
     }
 }
 
+void Terrain::computeNormalRow(int z) {
+    // Central differences of the heights, border vertices use one sided differences
+    int vertices = resolution + 1;
+    float spacing = size / resolution;
+    int z0 = std::max(z - 1, 0), z1 = std::min(z + 1, resolution);
+    const glm::vec3 *up = &positions[(size_t)z1 * vertices];
+    const glm::vec3 *row = &positions[(size_t)z * vertices];
+    const glm::vec3 *down = &positions[(size_t)z0 * vertices];
+    float dz = (z1 - z0) * spacing;
+
+    for (int x = 0; x <= resolution; x++) {
+        int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, resolution);
+        float dx = (x1 - x0) * spacing;
+        glm::vec3 n{(row[x0].y - row[x1].y) / dx, 1.f, (down[x].y - up[x].y) / dz};
+        normals[(size_t)z * vertices + x] = glm::normalize(n);
+    }
+}
+
+void Terrain::generateSurface() {
+    // Normals come out of the height pass unless erosion changes the heights in between
+    bool fused = finiteDifferenceNormals && erosionDroplets == 0;
+    generateHeights(fused);
+    if (erosionDroplets > 0) erode();
+    if (!fused) computeNormals();
+}
+
+void Terrain::generateLodPatterns() {
+    // Largest power of two chunk up to 64 quads that tiles the grid
+    chunkQuads = 64;
+    while (resolution % chunkQuads != 0) chunkQuads /= 2;
+    chunksPerSide = resolution / chunkQuads;
+    lodLevels = (int) std::log2(chunkQuads) + 1;
+    lodDistance = 2.0f * size * chunkQuads / resolution;
+
+    chunks.clear();
+    for (int z = 0; z < chunksPerSide; z++)
+        for (int x = 0; x < chunksPerSide; x++)
+            chunks.push_back({glm::vec3{0.f}, glm::vec3{0.f}, z * chunkQuads * (resolution + 1) + x * chunkQuads, 0});
+
+    indices.clear();
+    lodPatterns.clear();
+    for (int level = 0; level < lodLevels; level++) {
+        int step = 1 << level;
+        int quads = chunkQuads / step;
+
+        for (int mask = 0; mask < 16; mask++) {
+            // Odd vertices on edges next to a coarser chunk snap to the even ones the neighbor uses
+            auto vertex = [&](int i, int j) {
+                if (((mask & 1) && i == 0) || ((mask & 2) && i == quads)) j &= ~1;
+                if (((mask & 4) && j == 0) || ((mask & 8) && j == quads)) i &= ~1;
+                return (GLuint) (j * step * (resolution + 1) + i * step);
+            };
+            auto triangle = [&](GLuint a, GLuint b, GLuint c) {
+                if (a == b || b == c || a == c) return;
+                indices.push_back(a); indices.push_back(b); indices.push_back(c);
+            };
+
+            LodPattern pattern;
+            pattern.offset = indices.size() * sizeof(GLuint);
+            for (int j = 0; j < quads; j++) {
+                for (int i = 0; i < quads; i++) {
+                    GLuint i0 = vertex(i, j);
+                    GLuint i1 = vertex(i + 1, j);
+                    GLuint i2 = vertex(i, j + 1);
+                    GLuint i3 = vertex(i + 1, j + 1);
+                    triangle(i0, i2, i1);
+                    triangle(i1, i2, i3);
+                }
+            }
+            pattern.count = (GLsizei) (indices.size() - pattern.offset / sizeof(GLuint));
+            lodPatterns.push_back(pattern);
+        }
+    }
+}
+
+void Terrain::updateChunkBounds() {
+    for (auto &chunk : chunks) {
+        chunk.min = chunk.max = positions[chunk.baseVertex];
+        for (int j = 0; j <= chunkQuads; j++) {
+            for (int i = 0; i <= chunkQuads; i++) {
+                auto &p = positions[chunk.baseVertex + j * (resolution + 1) + i];
+                chunk.min = glm::min(chunk.min, p);
+                chunk.max = glm::max(chunk.max, p);
+            }
+        }
+    }
+
+    quadtree.clear();
+    buildQuadtree(0, 0, chunksPerSide, chunksPerSide);
+}
+
+int Terrain::buildQuadtree(int x0, int z0, int x1, int z1) {
+    int index = (int) quadtree.size();
+    quadtree.push_back({glm::vec3{0.f}, glm::vec3{0.f}, x0, z0, x1, z1, {-1, -1, -1, -1}});
+
+    // Leaves hold a single chunk
+    if (x1 - x0 == 1 && z1 - z0 == 1) {
+        auto &chunk = chunks[z0 * chunksPerSide + x0];
+        quadtree[index].min = chunk.min;
+        quadtree[index].max = chunk.max;
+        return index;
+    }
+
+    // Split the larger side in halves, children are appended so the node is looked up again by index
+    int xm = x1 - x0 > 1 ? (x0 + x1) / 2 : x1;
+    int zm = z1 - z0 > 1 ? (z0 + z1) / 2 : z1;
+    int ranges[4][4] = {{x0, z0, xm, zm}, {xm, z0, x1, zm}, {x0, zm, xm, z1}, {xm, zm, x1, z1}};
+    glm::vec3 lo{1e9f}, hi{-1e9f};
+    int children = 0;
+    for (auto &range : ranges) {
+        if (range[0] >= range[2] || range[1] >= range[3]) continue;
+        int child = buildQuadtree(range[0], range[1], range[2], range[3]);
+        lo = glm::min(lo, quadtree[child].min);
+        hi = glm::max(hi, quadtree[child].max);
+        quadtree[index].children[children++] = child;
+    }
+    quadtree[index].min = lo;
+    quadtree[index].max = hi;
+    return index;
+}
+
 void Terrain::computeNormals() {
-    normals.resize(positions.size(), glm::vec3(0.f));
+    if (finiteDifferenceNormals) {
+        normals.resize(positions.size());
+        #pragma omp parallel for schedule(static)
+        for (int z = 0; z <= resolution; z++) computeNormalRow(z);
+        return;
+    }
 
-    for (size_t i = 0; i < indices.size(); i += 3) {
-        int i0 = indices[i];
-        int i1 = indices[i + 1];
-        int i2 = indices[i + 2];
+    normals.assign(positions.size(), glm::vec3(0.f));
 
+    // Full detail triangles of every grid quad, same split as the level 0 pattern
+    auto addFace = [&](int i0, int i1, int i2) {
         glm::vec3 edge1 = positions[i1] - positions[i0];
         glm::vec3 edge2 = positions[i2] - positions[i0];
         glm::vec3 n = glm::cross(edge1, edge2);
@@ -446,6 +856,16 @@ void Terrain::computeNormals() {
         normals[i0] += n;
         normals[i1] += n;
         normals[i2] += n;
+    };
+    for (int z = 0; z < resolution; z++) {
+        for (int x = 0; x < resolution; x++) {
+            int i0 = z * (resolution + 1) + x;
+            int i1 = i0 + 1;
+            int i2 = i0 + (resolution + 1);
+            int i3 = i2 + 1;
+            addFace(i0, i2, i1);
+            addFace(i1, i2, i3);
+        }
     }
 
     for (auto &n : normals) {
@@ -454,26 +874,358 @@ void Terrain::computeNormals() {
     }
 }
 
+// ===================== Erosion =========================
+
+void Terrain::erode() {
+    auto report = [&](float progress) {
+        if (erosionProgress) erosionProgress(progress);
+    };
+
+    // Heights in grid cell units so that slopes do not depend on the terrain size
+    float spacing = size / resolution;
+    std::vector<float> heights(positions.size());
+    for (size_t i = 0; i < heights.size(); i++) heights[i] = positions[i].y / spacing;
+
+    // Droplets take most of the time
+    erodeHydraulic(heights, [&](float progress) { report(progress * 0.8f); });
+    erodeThermal(heights, [&](float progress) { report(0.8f + progress * 0.2f); });
+
+    for (size_t i = 0; i < heights.size(); i++) positions[i].y = heights[i] * spacing;
+}
+
+void Terrain::erodeHydraulic(std::vector<float> &heights, const std::function<void(float)> &progress) {
+    // Droplet parameters, distances are in grid cells
+    const int lifetime = 30;            // Steps of one cell before a droplet is dropped
+    const int radius = 3;               // Radius of the erosion brush
+    const float inertia = 0.05f;        // How much droplets keep their direction instead of following the slope
+    const float capacityFactor = 4.0f;  // Sediment a droplet can carry per unit of height drop, speed and water
+    const float minCapacity = 0.01f;
+    const float erodeSpeed = 0.3f;
+    const float depositSpeed = 0.3f;
+    const float evaporateSpeed = 0.01f;
+    const float gravity = 4.0f;
+
+    int vertices = resolution + 1;
+
+    // Weights of the brush fall off linearly from its center
+    struct BrushTap {
+        int x, z;
+        float weight;
+    };
+    std::vector<BrushTap> brush;
+    float weights = 0;
+    for (int z = -radius; z <= radius; z++) {
+        for (int x = -radius; x <= radius; x++) {
+            float weight = radius - std::sqrt((float) (x * x + z * z));
+            if (weight <= 0) continue;
+            brush.push_back({x, z, weight});
+            weights += weight;
+        }
+    }
+    for (auto &tap : brush) tap.weight /= weights;
+
+    // Height and gradient at a point between grid vertices
+    auto sample = [&](float px, float pz, float &gx, float &gz) {
+        int ix = (int) px, iz = (int) pz;
+        float u = px - ix, v = pz - iz;
+        const float *h = &heights[(size_t) iz * vertices + ix];
+        float nw = h[0], ne = h[1], sw = h[vertices], se = h[vertices + 1];
+        gx = (ne - nw) * (1 - v) + (se - sw) * v;
+        gz = (sw - nw) * (1 - u) + (se - ne) * u;
+        return nw * (1 - u) * (1 - v) + ne * u * (1 - v) + sw * (1 - u) * v + se * u * v;
+    };
+
+    // Droplets stay within lifetime + radius + 1 cells of the tile they start in. Tiles of the same color in a
+    // checkerboard are one tile apart, so with tiles at least twice that size they never touch the same vertices
+    // and run in parallel. Every tile has its own random sequence, the result does not depend on the threads.
+    const int tileSize = 128;
+    static_assert(tileSize >= 2 * (lifetime + radius + 1), "Erosion tiles of one color would overlap");
+    int tiles = (resolution + tileSize - 1) / tileSize;
+    const int passes = 10;
+    long long perPass = (long long) tiles * tiles * passes;
+
+    for (int pass = 0; pass < passes; pass++) {
+        for (int color = 0; color < 4; color++) {
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int tile = 0; tile < tiles * tiles; tile++) {
+                int tx = tile % tiles, tz = tile / tiles;
+                if ((tx & 1) + 2 * (tz & 1) != color) continue;
+
+                // Budget split evenly between the tiles and passes
+                long long slot = (long long) pass * tiles * tiles + tile;
+                int count = (int) (erosionDroplets / perPass + (slot < erosionDroplets % perPass ? 1 : 0));
+
+                std::mt19937 gen((unsigned) slot);
+                float x0 = (float) (tx * tileSize), z0 = (float) (tz * tileSize);
+                float extent = (float) std::min(tileSize, resolution - tx * tileSize);
+                float depth = (float) std::min(tileSize, resolution - tz * tileSize);
+                std::uniform_real_distribution<float> dis(0.f, 1.f);
+
+                for (int droplet = 0; droplet < count; droplet++) {
+                    float px = x0 + dis(gen) * extent * 0.999f;
+                    float pz = z0 + dis(gen) * depth * 0.999f;
+                    float dx = 0, dz = 0, speed = 1, water = 1, sediment = 0;
+
+                    for (int step = 0; step < lifetime; step++) {
+                        int ix = (int) px, iz = (int) pz;
+                        float u = px - ix, v = pz - iz;
+                        float gx, gz;
+                        float height = sample(px, pz, gx, gz);
+
+                        // Follow the slope, keeping a bit of the previous direction
+                        dx = dx * inertia - gx * (1 - inertia);
+                        dz = dz * inertia - gz * (1 - inertia);
+                        float length = std::sqrt(dx * dx + dz * dz);
+                        if (length < 1e-6f) break;
+                        dx /= length;
+                        dz /= length;
+                        px += dx;
+                        pz += dz;
+                        if (px < 0 || pz < 0 || px >= resolution || pz >= resolution) break;
+
+                        float deltaHeight = sample(px, pz, gx, gz) - height;
+                        float capacity = std::max(-deltaHeight * speed * water * capacityFactor, minCapacity);
+
+                        if (sediment > capacity || deltaHeight > 0) {
+                            // Fill the pit when going uphill, drop the excess otherwise, spread over the old cell
+                            float amount = deltaHeight > 0 ? std::min(deltaHeight, sediment)
+                                                           : (sediment - capacity) * depositSpeed;
+                            sediment -= amount;
+                            float *h = &heights[(size_t) iz * vertices + ix];
+                            h[0] += amount * (1 - u) * (1 - v);
+                            h[1] += amount * u * (1 - v);
+                            h[vertices] += amount * (1 - u) * v;
+                            h[vertices + 1] += amount * u * v;
+                        } else {
+                            // Never dig deeper than the height dropped
+                            float amount = std::min((capacity - sediment) * erodeSpeed, -deltaHeight);
+                            for (auto &tap : brush) {
+                                int bx = ix + tap.x, bz = iz + tap.z;
+                                if (bx < 0 || bz < 0 || bx > resolution || bz > resolution) continue;
+                                float removed = amount * tap.weight;
+                                heights[(size_t) bz * vertices + bx] -= removed;
+                                sediment += removed;
+                            }
+                        }
+
+                        speed = std::sqrt(std::max(speed * speed - deltaHeight * gravity, 0.f));
+                        water *= 1 - evaporateSpeed;
+                    }
+                }
+            }
+        }
+        progress((float) (pass + 1) / passes);
+    }
+}
+
+void Terrain::erodeThermal(std::vector<float> &heights, const std::function<void(float)> &progress) {
+    // Material slides to lower neighbors where the slope exceeds the talus angle, in grid cell units
+    const float talus = 1.0f;
+    const float rate = 0.25f;
+    // Height difference allowed towards each of the 3x3 neighbors
+    const float limit[3][3] = {{talus * 1.4142135f, talus, talus * 1.4142135f},
+                               {talus, 0.f, talus},
+                               {talus * 1.4142135f, talus, talus * 1.4142135f}};
+
+    int vertices = resolution + 1;
+    std::vector<float> share(heights.size()), next(heights.size());
+
+    // Every vertex moves rate times its largest excess over the talus slope, split between its lower neighbors by
+    // their excess. Both passes only read the previous iteration so rows are independent. Neighbors outside the grid
+    // are clamped to the vertex itself, which never slides.
+    for (int iteration = 0; iteration < erosionThermalIterations; iteration++) {
+        #pragma omp parallel for schedule(static)
+        for (int z = 0; z <= resolution; z++) {
+            const float *rows[3] = {&heights[(size_t) std::max(z - 1, 0) * vertices],
+                                    &heights[(size_t) z * vertices],
+                                    &heights[(size_t) std::min(z + 1, resolution) * vertices]};
+            for (int x = 0; x <= resolution; x++) {
+                int columns[3] = {std::max(x - 1, 0), x, std::min(x + 1, resolution)};
+                float height = rows[1][x], largest = 0, total = 0;
+                for (int j = 0; j < 3; j++) {
+                    for (int i = 0; i < 3; i++) {
+                        if (i == 1 && j == 1) continue;
+                        float excess = std::max(height - rows[j][columns[i]] - limit[j][i], 0.f);
+                        largest = std::max(largest, excess);
+                        total += excess;
+                    }
+                }
+                share[(size_t) z * vertices + x] = total > 0 ? rate * largest / total : 0.f;
+            }
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (int z = 0; z <= resolution; z++) {
+            size_t offsets[3] = {(size_t) std::max(z - 1, 0) * vertices, (size_t) z * vertices,
+                                 (size_t) std::min(z + 1, resolution) * vertices};
+            for (int x = 0; x <= resolution; x++) {
+                int columns[3] = {std::max(x - 1, 0), x, std::min(x + 1, resolution)};
+                size_t idx = offsets[1] + x;
+                float height = heights[idx], result = height;
+                for (int j = 0; j < 3; j++) {
+                    for (int i = 0; i < 3; i++) {
+                        if (i == 1 && j == 1) continue;
+                        // Inflow when the neighbor is higher, outflow when it is lower, the limits are symmetric
+                        size_t neighbor = offsets[j] + columns[i];
+                        float difference = heights[neighbor] - height;
+                        result += share[neighbor] * std::max(difference - limit[j][i], 0.f);
+                        result -= share[idx] * std::max(-difference - limit[j][i], 0.f);
+                    }
+                }
+                next[idx] = result;
+            }
+        }
+
+        heights.swap(next);
+        progress((float) (iteration + 1) / erosionThermalIterations);
+    }
+}
+
 void Terrain::updateBuffers() {
-    glBindVertexArray(vao);
+    // Convert straight into the buffers allocated in the constructor, indices never change
+    auto count = (int) positions.size();
+    auto access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+
+    // Either target may be null and is skipped then
+    auto convert = [&](float *heights, GLuint *packedNormals) {
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < count; i++) {
+            if (heights) heights[i] = positions[i].y;
+            if (packedNormals) packedNormals[i] = glm::packUnorm3x10_1x2(glm::vec4(normals[i] * 0.5f + 0.5f, 0.f));
+        }
+    };
 
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3),
-                 positions.data(), GL_STATIC_DRAW);
-
+    auto heights = (float *) glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(float), access);
     glBindBuffer(GL_ARRAY_BUFFER, nbo);
-    glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3),
-                 normals.data(), GL_STATIC_DRAW);
+    auto packedNormals = (GLuint *) glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(GLuint), access);
 
-    glBindBuffer(GL_ARRAY_BUFFER, tbo);
-    glBufferData(GL_ARRAY_BUFFER, uvs.size() * sizeof(glm::vec2),
-                 uvs.data(), GL_STATIC_DRAW);
+    convert(heights, packedNormals);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-                 indices.data(), GL_STATIC_DRAW);
+    // Unmapping fails when the contents got corrupted while mapped
+    bool normalsUploaded = packedNormals && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    bool heightsUploaded = heights && glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    if (heightsUploaded && normalsUploaded) return;
+
+    // Buffers that could not be mapped or got corrupted are converted in client memory and uploaded from there
+    std::vector<float> heightCopy(heightsUploaded ? 0 : count);
+    std::vector<GLuint> normalCopy(normalsUploaded ? 0 : count);
+    convert(heightsUploaded ? nullptr : heightCopy.data(), normalsUploaded ? nullptr : normalCopy.data());
+    if (!heightsUploaded)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(float), heightCopy.data());
+    if (!normalsUploaded) {
+        glBindBuffer(GL_ARRAY_BUFFER, nbo);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(GLuint), normalCopy.data());
+    }
+}
 
-    indexCount = indices.size();
+bool Terrain::generateOnGpu() {
+    GLsizei vertices = resolution + 1;
+
+    // The whole grid is rendered in one pass
+    GLint maxTextureSize, maxViewport[2];
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    if (vertices > maxTextureSize || vertices > maxViewport[0] || vertices > maxViewport[1])
+        return false;
+    // Lookup tables are single rows
+    if ((GLint) voronoiCells.size() > maxTextureSize || (GLint) voronoiBucketStart.size() > maxTextureSize)
+        return false;
+
+    if (!heightShader) {
+        heightShader = std::make_unique<ppgso::Shader>(terrain_gen_vert_glsl, terrain_gen_frag_glsl);
+        heightShader->watch("terrain_gen_vert.glsl", "terrain_gen_frag.glsl");
+        normalShader = std::make_unique<ppgso::Shader>(terrain_gen_vert_glsl, terrain_normal_frag_glsl);
+        normalShader->watch("terrain_gen_vert.glsl", "terrain_normal_frag.glsl");
+    }
+
+    // Render into our framebuffer, restored when done
+    GLint previousFramebuffer, previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    // Targets are allocated once, the lookup tables are refilled since the Voronoi cells may have changed.
+    // Integer textures need nearest filtering to be complete.
+    bool created = gpuFramebuffer == 0;
+    if (created) {
+        glGenTextures(GPU_TEXTURES, gpuTextures);
+        glGenFramebuffers(1, &gpuFramebuffer);
+        glGenVertexArrays(1, &gpuVao);
+    }
+    auto fillTexture = [&](int texture, GLint format, GLsizei width, GLsizei height,
+                           GLenum dataFormat, GLenum dataType, const void *data) {
+        ppgso::state::bindTexture(0, GL_TEXTURE_2D, gpuTextures[texture]);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, dataFormat, dataType, data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    };
+    fillTexture(GPU_PERMUTATION, GL_R32I, (GLsizei) permutation.size(), 1, GL_RED_INTEGER, GL_INT,
+                permutation.data());
+    fillTexture(GPU_CELLS, GL_RG32F, (GLsizei) voronoiCells.size(), 1, GL_RG, GL_FLOAT, voronoiCells.data());
+    fillTexture(GPU_BUCKETS, GL_R32I, (GLsizei) voronoiBucketStart.size(), 1, GL_RED_INTEGER, GL_INT,
+                voronoiBucketStart.data());
+    if (created) {
+        fillTexture(GPU_POSITIONS, GL_RGBA32F, vertices, vertices, GL_RGBA, GL_FLOAT, nullptr);
+        fillTexture(GPU_NORMALS, GL_RGBA32F, vertices, vertices, GL_RGBA, GL_FLOAT, nullptr);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, gpuFramebuffer);
+    ppgso::state::bindVertexArray(gpuVao);
+    glViewport(0, 0, vertices, vertices);
+
+    // Height pass
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gpuTextures[GPU_POSITIONS], 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete) {
+        heightShader->use();
+        ppgso::state::bindTexture(0, GL_TEXTURE_2D, gpuTextures[GPU_PERMUTATION]);
+        ppgso::state::bindTexture(1, GL_TEXTURE_2D, gpuTextures[GPU_CELLS]);
+        ppgso::state::bindTexture(2, GL_TEXTURE_2D, gpuTextures[GPU_BUCKETS]);
+        glUniform1i(heightShader->getUniformLocation("permutation"), 0);
+        glUniform1i(heightShader->getUniformLocation("voronoiCells"), 1);
+        glUniform1i(heightShader->getUniformLocation("voronoiBucketStart"), 2);
+        glUniform2i(heightShader->getUniformLocation("voronoiBuckets"), voronoiBuckets.x, voronoiBuckets.y);
+        heightShader->setUniform("voronoiOrigin", voronoiOrigin);
+        heightShader->setUniform("voronoiBucketSize", voronoiBucketSize);
+        glUniform1i(heightShader->getUniformLocation("resolution"), resolution);
+        glUniform1i(heightShader->getUniformLocation("terrainType"), (GLint) type);
+        heightShader->setUniform("size", size);
+        heightShader->setUniform("maxHeight", maxHeight);
+        heightShader->setUniform("noiseFrequency", noiseFrequency);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        // Normal pass reads the positions, so they must not stay attached
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gpuTextures[GPU_NORMALS], 0);
+        normalShader->use();
+        ppgso::state::bindTexture(0, GL_TEXTURE_2D, gpuTextures[GPU_POSITIONS]);
+        glUniform1i(normalShader->getUniformLocation("positions"), 0);
+        glUniform1i(normalShader->getUniformLocation("resolution"), resolution);
+        glUniform1i(normalShader->getUniformLocation("finiteDifference"), finiteDifferenceNormals);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        // Read both straight into the vertex buffers in their compact formats, rows of the textures are rows
+        // of the grid. The normals stay on the GPU only.
+        size_t count = (size_t) vertices * vertices;
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, nbo);
+        glReadPixels(0, 0, vertices, vertices, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, nullptr);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gpuTextures[GPU_POSITIONS], 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, vbo);
+        glReadPixels(0, 0, vertices, vertices, GL_GREEN, GL_FLOAT, nullptr);
+
+        // getHeightAt and the chunk bounds work with the CPU copy
+        std::vector<float> heights(count);
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, count * sizeof(float), heights.data());
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        for (size_t i = 0; i < count; i++) positions[i].y = heights[i];
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+    return complete;
 }
 
 // ===================== Public API =========================
@@ -494,8 +1246,44 @@ void Terrain::setNoiseFrequency(float freq) {
     regenerate();
 }
 
+void Terrain::setVoronoiCellCount(int count) {
+    initVoronoiCells(std::max(count, 1));
+    if (type == TerrainType::VORONOI) regenerate();
+}
+
+void Terrain::setGpuGeneration(bool enabled) {
+    gpuGeneration = enabled;
+    regenerate();
+}
+
+void Terrain::setErosion(int droplets, int thermalIterations) {
+    erosionDroplets = std::max(droplets, 0);
+    erosionThermalIterations = std::max(thermalIterations, 0);
+    regenerate();
+}
+
+void Terrain::setErosionProgress(std::function<void(float)> callback) {
+    erosionProgress = std::move(callback);
+}
+
+void Terrain::setFiniteDifferenceNormals(bool enabled) {
+    finiteDifferenceNormals = enabled;
+    regenerate();
+}
+
 void Terrain::regenerate() {
-    generateGrid();
-    computeNormals();
-    updateBuffers();
+    auto start = std::chrono::steady_clock::now();
+
+    // Grid layout, UVs, indices and island fields only depend on the resolution, only heights and normals change.
+    // Erosion runs on the CPU only.
+    bool gpu = gpuGeneration && erosionDroplets == 0 && generateOnGpu();
+    if (!gpu) {
+        generateSurface();
+        updateBuffers();
+    }
+    updateChunkBounds();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    lastGenerationTime = elapsed.count();
+    lastGenerationOnGpu = gpu;
 }
\ No newline at end of file
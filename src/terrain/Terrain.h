@@ -3,6 +3,7 @@
 #include <ppgso/ppgso.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/noise.hpp>
+#include <functional>
 #include <vector>
 #include <memory>
 
@@ -25,7 +26,15 @@ public:
     ~Terrain();
 
     void update(float dt);
-    void render(const glm::mat4 &view, const glm::mat4 &projection);
+    // Camera matrices are read from the bound "Frame" uniform buffer, draws all chunks at full detail
+    void render();
+    // Draw only chunks visible from the camera, detail decreases with distance from eye
+    void render(const glm::vec3 &eye, const glm::mat4 &viewProjection);
+
+    // Distance from the camera at which chunks switch to the next coarser level of detail
+    void setLodDistance(float distance) { lodDistance = distance; }
+    // Triangles drawn by the last render call
+    size_t getRenderedTriangles() const { return renderedTriangles; }
 
     // Terrain type switching
     void setType(TerrainType newType);
@@ -35,20 +44,80 @@ public:
     void setHeightScale(float scale);
     void setNoiseFrequency(float freq);
     void regenerate();
+    // Duration of the last generation in milliseconds and whether it ran on the GPU
+    double getLastGenerationTime() const { return lastGenerationTime; }
+    bool getLastGenerationOnGpu() const { return lastGenerationOnGpu; }
+
+    // Number of cells of TerrainType::VORONOI, placed from a fixed seed so the first cells stay the same
+    void setVoronoiCellCount(int count);
+    int getVoronoiCellCount() const { return (int) voronoiCells.size(); }
+
+    // Evaluate heights and normals on the GPU when regenerating, falls back to the CPU if the grid does not fit
+    void setGpuGeneration(bool enabled);
+    bool getGpuGeneration() const { return gpuGeneration; }
+
+    // Particle based hydraulic and thermal erosion of the generated heights, the number of droplets is the time
+    // budget and 0 disables erosion. Deterministic for the same parameters.
+    void setErosion(int droplets, int thermalIterations = 20);
+    int getErosionDroplets() const { return erosionDroplets; }
+    // Called with the finished fraction of the erosion while the terrain regenerates
+    void setErosionProgress(std::function<void(float)> callback);
+
+    // Compute normals from central differences of the heights together with them instead of averaging face normals
+    void setFiniteDifferenceNormals(bool enabled);
+    bool getFiniteDifferenceNormals() const { return finiteDifferenceNormals; }
 
     // Height query for collision detection
     float getHeightAt(float worldX, float worldZ) const;
 
+    // Heights of the terrain type without the island falloff for any world position, used to stream unbounded
+    // terrain. Safe to call from several threads as long as the terrain parameters do not change meanwhile.
+    void sampleHeights(const float *x, const float *z, float *out, int count) const;
+    float getMaxHeight() const { return maxHeight; }
+
 private:
-    // Mesh data
+    // Mesh data, only heights and packed normals are uploaded, grid positions and UVs are rebuilt by the vertex shader
     std::vector<glm::vec3> positions;
     std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> uvs;
-    std::vector<unsigned int> indices;
-
-    // OpenGL buffers
-    GLuint vao = 0, vbo = 0, nbo = 0, tbo = 0, ebo = 0;
-    size_t indexCount = 0;
+    // Index patterns of a single chunk relative to its first vertex, shared by all chunks
+    std::vector<GLuint> indices;
+
+    // Triangles of a chunk at one level of detail, edges towards coarser neighbors are stitched
+    struct LodPattern {
+        GLsizei count;      // Number of indices in the pattern
+        size_t offset;      // Byte offset of the pattern in the index buffer
+    };
+    // Indexed by level * 16 + mask of edges (-x, +x, -z, +z) whose neighbor is one level coarser
+    std::vector<LodPattern> lodPatterns;
+
+    // Square block of grid quads drawn with one pattern
+    struct Chunk {
+        glm::vec3 min, max; // World space bounds
+        GLint baseVertex;   // Grid vertex at the chunk origin
+        int level;          // Level of detail selected by the last render
+    };
+    std::vector<Chunk> chunks;
+    int chunkQuads = 1;     // Quads along a chunk side, a power of two dividing the resolution
+    int chunksPerSide = 1;
+    int lodLevels = 1;      // Level l skips 2^l - 1 vertices between drawn ones
+    float lodDistance;
+    size_t renderedTriangles = 0;
+
+    // Quadtree over the chunks for hierarchical culling, node 0 is the root
+    struct QuadNode {
+        glm::vec3 min, max;
+        int x0, z0, x1, z1; // Chunk range covered by the node
+        int children[4];    // Child nodes, -1 when missing
+    };
+    std::vector<QuadNode> quadtree;
+
+    // Draw batch rebuilt every frame
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void *> drawOffsets;
+    std::vector<GLint> drawBaseVertices;
+
+    // OpenGL buffers, vbo holds a float height and nbo a 10:10:10 unsigned normalized normal per vertex
+    GLuint vao = 0, vbo = 0, nbo = 0, ebo = 0;
 
     // Terrain parameters
     int resolution;
@@ -56,41 +125,87 @@ private:
     float maxHeight;
     float noiseFrequency = 1.0f;
     TerrainType type;
-
-    // Voronoi cell cache for consistency
+    bool gpuGeneration = false;
+    bool finiteDifferenceNormals = true;
+    int erosionDroplets = 0;
+    int erosionThermalIterations = 20;
+    std::function<void(float)> erosionProgress;
+    double lastGenerationTime = 0.0;
+    bool lastGenerationOnGpu = false;
+
+    // Island shape and coast type of every grid vertex, independent of the terrain type and noise parameters
+    std::vector<float> islandShapes;
+    std::vector<float> coastTypes;
+
+    // Voronoi cell cache for consistency, sorted by the buckets of a uniform grid so lookups visit nearby cells only
     std::vector<glm::vec2> voronoiCells;
-    void initVoronoiCells();
+    std::vector<int> voronoiBucketStart;    // First cell of every bucket, the extra last entry is the cell count
+    glm::vec2 voronoiOrigin;                // Corner of bucket (0, 0)
+    glm::ivec2 voronoiBuckets;              // Number of buckets along x and z
+    float voronoiBucketSize;
+    void initVoronoiCells(int count = 64);
 
     // Perlin noise helpers
-    float fade(float t);
-    float lerp(float t, float a, float b);
-    float grad(int hash, float x, float y);
+    float fade(float t) const;
+    float lerp(float t, float a, float b) const;
+    float grad(int hash, float x, float y) const;
 
     // Noise functions
-    float perlin(float x, float y);
-    float fbm(float x, float y, int octaves = 5);
-    float ridged(float x, float y);
-    float voronoi(float x, float y);
-    float canyon(float x, float y);
-    float plateaus(float x, float y);
-
-    // Masks and filters
+    float perlin(float x, float y) const;
+    float fbm(float x, float y, int octaves = 5) const;
+    float ridged(float x, float y) const;
+    float voronoi(float x, float y) const;
+    float canyon(float x, float y) const;
+    float plateaus(float x, float y) const;
+
+    // Batched noise, evaluates count samples at once in loops the compiler vectorizes
+    void perlin(const float *x, const float *y, float *out, int count) const;
+    void fbm(const float *x, const float *y, float *out, int count, int octaves = 5) const;
+    void ridged(const float *x, const float *y, float *out, int count) const;
+    void canyon(const float *x, const float *y, float *out, int count) const;
+    void plateaus(const float *x, const float *y, float *out, int count) const;
+
+    // Base noise of the selected terrain type normalized to 0-1 for a batch of samples
+    void baseNoise(const float *x, const float *y, float *out, int count) const;
+
+    // Masks
     float islandMask(float x, float y);
     float coastlineVariation(float x, float y);
-    float erosionFilter(float height, float slope);
 
     // Permutation table for Perlin noise
     static std::vector<int> permutation;
 
-    // Final height computation
-    float finalHeight(float x, float y);
+    // Final height computation from the precomputed base noise and island fields
+    float finalHeight(float x, float y, float baseNoise, float islandShape, float coastType);
 
-    // Mesh generation
+    // Mesh generation, the grid layout is built once and regeneration only replaces heights and normals
     void generateGrid();
+    void generateHeights(bool withNormals);   // Computes finite difference normals in the same parallel region
+    void generateSurface();                   // Heights, erosion and normals
+    void generateLodPatterns();
+    void updateChunkBounds();
+    int buildQuadtree(int x0, int z0, int x1, int z1);
     void computeNormals();
+    void computeNormalRow(int z);
+
+    // Erosion of the heights in grid cell units, see setErosion
+    void erode();
+    void erodeHydraulic(std::vector<float> &heights, const std::function<void(float)> &progress);
+    void erodeThermal(std::vector<float> &heights, const std::function<void(float)> &progress);
     void updateBuffers();
+    void drawBatch();
+
+    // Render heights and normals into float textures and read them back into the vertex buffers
+    bool generateOnGpu();
+
+    // Lookup tables, render targets and framebuffer of the GPU generation, created on first use and kept for
+    // the following regenerations since the resolution never changes
+    enum { GPU_PERMUTATION, GPU_CELLS, GPU_BUCKETS, GPU_POSITIONS, GPU_NORMALS, GPU_TEXTURES };
+    GLuint gpuTextures[GPU_TEXTURES] = {};
+    GLuint gpuFramebuffer = 0, gpuVao = 0;
 
     // Shader (shared across all terrain instances)
     static std::unique_ptr<ppgso::Shader> shader;
+    static std::unique_ptr<ppgso::Shader> heightShader, normalShader;
     static int instanceCount;
 };
\ No newline at end of file
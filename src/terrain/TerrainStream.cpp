@@ -0,0 +1,273 @@
+#include "TerrainStream.h"
+#include <algorithm>
+#include <cmath>
+
+#include <shaders/terrain_vert_glsl.h>
+#include <shaders/terrain_frag_glsl.h>
+
+// Static member initialization
+std::unique_ptr<ppgso::Shader> TerrainStream::shader;
+int TerrainStream::instanceCount = 0;
+
+TerrainStream::TerrainStream(const Terrain &source, float tileSize, int tileResolution, int viewRadius, size_t memoryBudget)
+        : source(source), tileSize(tileSize), tileResolution(tileResolution), viewRadius(viewRadius),
+          memoryBudget(memoryBudget) {
+
+    int vertices = tileResolution + 1;
+    if (vertices * vertices > 65536)
+        throw std::runtime_error("Terrain tile resolution too large for 16 bit indices!");
+
+    instanceCount++;
+
+    if (!shader) {
+        shader = std::make_unique<ppgso::Shader>(terrain_vert_glsl, terrain_frag_glsl, true);
+        shader->watch("terrain_vert.glsl", "terrain_frag.glsl");
+    }
+    tileBytes = (size_t)vertices * vertices * 8 * sizeof(float);
+
+    // Tiles wanted by one frame must fit into the budget, otherwise they evict each other every frame
+    auto tilesInRadius = [](int radius) {
+        size_t count = 0;
+        for (int dz = -radius; dz <= radius; dz++)
+            for (int dx = -radius; dx <= radius; dx++)
+                if (dx * dx + dz * dz <= radius * radius) count++;
+        return count;
+    };
+    while (this->viewRadius > 0 && tilesInRadius(this->viewRadius) * tileBytes > memoryBudget)
+        this->viewRadius--;
+
+    // All tiles share the same grid topology
+    std::vector<GLushort> indices;
+    for (int z = 0; z < tileResolution; z++) {
+        for (int x = 0; x < tileResolution; x++) {
+            int i0 = z * vertices + x;
+            int i1 = i0 + 1;
+            int i2 = i0 + vertices;
+            int i3 = i2 + 1;
+
+            indices.push_back(i0); indices.push_back(i2); indices.push_back(i1);
+            indices.push_back(i1); indices.push_back(i2); indices.push_back(i3);
+        }
+    }
+    indexCount = (GLsizei)indices.size();
+
+    // Filled through a target that is not vertex array state, tile vertex arrays attach it in upload
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Leave a core to the render thread
+    unsigned threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    for (unsigned i = 0; i < threads; i++)
+        workers.emplace_back(&TerrainStream::worker, this);
+}
+
+TerrainStream::~TerrainStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    work.notify_all();
+    for (auto &thread : workers) thread.join();
+
+    while (!lru.empty()) evict(lru.back());
+    glDeleteBuffers(1, &ebo);
+
+    instanceCount--;
+
+    if (instanceCount == 0) {
+        shader.reset();
+    }
+}
+
+int64_t TerrainStream::key(glm::ivec2 coord) {
+    return (int64_t)(((uint64_t)(uint32_t)coord.x << 32) | (uint32_t)coord.y);
+}
+
+void TerrainStream::update(const glm::vec3 &eye) {
+    glm::ivec2 center{(int)std::floor(eye.x / tileSize), (int)std::floor(eye.z / tileSize)};
+
+    // Tiles within the view radius, nearest first
+    std::vector<glm::ivec2> wanted;
+    for (int dz = -viewRadius; dz <= viewRadius; dz++)
+        for (int dx = -viewRadius; dx <= viewRadius; dx++)
+            if (dx * dx + dz * dz <= viewRadius * viewRadius)
+                wanted.push_back(center + glm::ivec2{dx, dz});
+    std::sort(wanted.begin(), wanted.end(), [&](glm::ivec2 a, glm::ivec2 b) {
+        glm::ivec2 da = a - center, db = b - center;
+        return da.x * da.x + da.y * da.y < db.x * db.x + db.y * db.y;
+    });
+
+    std::vector<std::unique_ptr<TileData>> uploads;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Requests the camera moved away from are dropped before workers get to them
+        for (auto coord : queue) pending.erase(key(coord));
+        queue.clear();
+
+        for (auto coord : wanted) {
+            auto tileKey = key(coord);
+            if (!tiles.count(tileKey) && !pending.count(tileKey)) {
+                queue.push_back(coord);
+                pending.insert(tileKey);
+            }
+        }
+
+        // Take a few finished tiles, the rest waits for the next frames
+        int count = std::min((int)finished.size(), uploadsPerFrame);
+        for (int i = 0; i < count; i++) {
+            pending.erase(key(finished[i]->coord));
+            uploads.push_back(std::move(finished[i]));
+        }
+        finished.erase(finished.begin(), finished.begin() + count);
+    }
+    work.notify_all();
+
+    for (auto &data : uploads) upload(*data);
+
+    // Wanted tiles move to the front after the uploads, so only tiles the camera left are evicted when over budget
+    for (auto coord = wanted.rbegin(); coord != wanted.rend(); ++coord) {
+        auto tile = tiles.find(key(*coord));
+        if (tile != tiles.end()) lru.splice(lru.begin(), lru, tile->second.lru);
+    }
+    while (tiles.size() * tileBytes > memoryBudget) evict(lru.back());
+}
+
+void TerrainStream::render(const glm::mat4 &viewProjection) {
+    if (tiles.empty()) return;
+
+    shader->use();
+    shader->setUniform("modelMatrix", glm::mat4(1.f));
+
+    auto frustum = ppgso::computeFrustum(viewProjection);
+    for (auto &entry : tiles) {
+        auto &tile = entry.second;
+        if (!ppgso::intersects(frustum, tile.min, tile.max)) continue;
+
+        ppgso::state::bindVertexArray(tile.vao);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, nullptr);
+    }
+}
+
+void TerrainStream::reset() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (auto coord : queue) pending.erase(key(coord));
+        queue.clear();
+
+        // Tiles being generated still read the source terrain
+        idle.wait(lock, [this] { return busy == 0; });
+        finished.clear();
+        pending.clear();
+    }
+
+    while (!lru.empty()) evict(lru.back());
+}
+
+void TerrainStream::worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work.wait(lock, [this] { return !running || !queue.empty(); });
+        if (!running) return;
+
+        auto coord = queue.front();
+        queue.pop_front();
+        busy++;
+
+        lock.unlock();
+        auto data = generate(coord);
+        lock.lock();
+
+        busy--;
+        finished.push_back(std::move(data));
+        if (busy == 0) idle.notify_all();
+    }
+}
+
+std::unique_ptr<TerrainStream::TileData> TerrainStream::generate(glm::ivec2 coord) const {
+    auto data = std::make_unique<TileData>();
+    data->coord = coord;
+
+    // Heights with a one sample border so normals match across tile edges
+    int vertices = tileResolution + 1;
+    int border = vertices + 2;
+    float spacing = tileSize / tileResolution;
+    glm::vec2 origin = glm::vec2(coord) * tileSize;
+
+    std::vector<float> heights((size_t)border * border);
+    std::vector<float> rowX(border), rowZ(border);
+    for (int z = 0; z < border; z++) {
+        for (int x = 0; x < border; x++) {
+            rowX[x] = origin.x + (x - 1) * spacing;
+            rowZ[x] = origin.y + (z - 1) * spacing;
+        }
+        source.sampleHeights(rowX.data(), rowZ.data(), &heights[(size_t)z * border], border);
+    }
+
+    data->vertices.resize((size_t)vertices * vertices * 8);
+    data->minHeight = data->maxHeight = heights[border + 1];
+    float maxHeight = source.getMaxHeight();
+    for (int z = 0; z < vertices; z++) {
+        for (int x = 0; x < vertices; x++) {
+            auto h = [&](int dx, int dz) { return heights[(size_t)(z + 1 + dz) * border + x + 1 + dx]; };
+            float height = h(0, 0);
+            glm::vec3 normal = glm::normalize(glm::vec3{h(-1, 0) - h(1, 0), 2.0f * spacing, h(0, -1) - h(0, 1)});
+
+            float *v = &data->vertices[((size_t)z * vertices + x) * 8];
+            v[0] = origin.x + x * spacing;
+            v[1] = height;
+            v[2] = origin.y + z * spacing;
+            v[3] = normal.x;
+            v[4] = normal.y;
+            v[5] = normal.z;
+            // Sand close to sea level, grass higher up
+            v[6] = (float)x / tileResolution;
+            v[7] = glm::clamp(1.0f - height / (0.2f * maxHeight), 0.0f, 1.0f);
+
+            data->minHeight = std::min(data->minHeight, height);
+            data->maxHeight = std::max(data->maxHeight, height);
+        }
+    }
+
+    return data;
+}
+
+void TerrainStream::upload(const TileData &data) {
+    Tile tile;
+    glm::vec2 origin = glm::vec2(data.coord) * tileSize;
+    tile.min = {origin.x, data.minHeight, origin.y};
+    tile.max = {origin.x + tileSize, data.maxHeight, origin.y + tileSize};
+
+    glGenVertexArrays(1, &tile.vao);
+    ppgso::state::bindVertexArray(tile.vao);
+
+    glGenBuffers(1, &tile.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, tile.vbo);
+    glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(float), data.vertices.data(), GL_STATIC_DRAW);
+
+    GLsizei stride = 8 * sizeof(float);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, nullptr);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void *>(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void *>(6 * sizeof(float)));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    auto tileKey = key(data.coord);
+    lru.push_front(tileKey);
+    tile.lru = lru.begin();
+    tiles[tileKey] = tile;
+}
+
+void TerrainStream::evict(int64_t tileKey) {
+    auto &tile = tiles.at(tileKey);
+    ppgso::state::releaseVertexArray(tile.vao);
+    glDeleteVertexArrays(1, &tile.vao);
+    glDeleteBuffers(1, &tile.vbo);
+    lru.erase(tile.lru);
+    tiles.erase(tileKey);
+}
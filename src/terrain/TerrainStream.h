@@ -0,0 +1,94 @@
+#pragma once
+
+#include <ppgso/ppgso.h>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Terrain.h"
+
+// Unbounded terrain made of square tiles generated around the camera on worker threads
+class TerrainStream {
+public:
+    // Tiles sample the noise of source, which must not change while the stream is generating (see reset)
+    // The view radius is reduced until the tiles inside it fit into the memory budget
+    TerrainStream(const Terrain &source,
+                  float tileSize = 128.0f,
+                  int tileResolution = 64,
+                  int viewRadius = 6,
+                  size_t memoryBudget = 64u << 20);
+
+    ~TerrainStream();
+
+    // Request tiles around the eye and upload finished ones, call once per frame
+    void update(const glm::vec3 &eye);
+    // Draw resident tiles inside the frustum, camera matrices are read from the bound "Frame" uniform buffer
+    void render(const glm::mat4 &viewProjection);
+
+    // Wait for workers and drop all tiles, call before changing the source terrain
+    void reset();
+
+    // Tiles uploaded per update, limits the render thread time spent on uploads
+    void setUploadsPerFrame(int count) { uploadsPerFrame = count; }
+
+    size_t getResidentTiles() const { return tiles.size(); }
+    size_t getResidentBytes() const { return tiles.size() * tileBytes; }
+
+private:
+    // Vertex data produced by a worker
+    struct TileData {
+        glm::ivec2 coord;
+        std::vector<float> vertices;    // Interleaved position, normal and uv
+        float minHeight, maxHeight;
+    };
+
+    // Tile resident on the GPU
+    struct Tile {
+        GLuint vao = 0, vbo = 0;
+        glm::vec3 min, max;
+        std::list<int64_t>::iterator lru;
+    };
+
+    const Terrain &source;
+    float tileSize;
+    int tileResolution;
+    int viewRadius;
+    size_t memoryBudget;
+    size_t tileBytes;
+    int uploadsPerFrame = 4;
+
+    // Resident tiles, most recently used at the front of lru
+    std::unordered_map<int64_t, Tile> tiles;
+    std::list<int64_t> lru;
+
+    // Index buffer shared by all tiles
+    GLuint ebo = 0;
+    GLsizei indexCount = 0;
+
+    // Work shared with the workers
+    std::mutex mutex;
+    std::condition_variable work, idle;
+    std::deque<glm::ivec2> queue;
+    std::vector<std::unique_ptr<TileData>> finished;
+    std::set<int64_t> pending;  // Queued, generating or finished but not uploaded
+    int busy = 0;
+    bool running = true;
+    std::vector<std::thread> workers;
+
+    static std::unique_ptr<ppgso::Shader> shader;
+    static int instanceCount;
+
+    static int64_t key(glm::ivec2 coord);
+    void worker();
+    std::unique_ptr<TileData> generate(glm::ivec2 coord) const;
+    void upload(const TileData &data);
+    void evict(int64_t tileKey);
+};